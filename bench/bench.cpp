@@ -0,0 +1,445 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include "ArgumentParser.hpp"
+#include "sat_solver.hpp"
+
+using std::cout; using std::cerr; using std::endl;
+using std::string; using std::vector;
+using Satyricon::Literal;
+using Utils::ArgumentParser;
+
+// description of program, both for documenation and help message
+std::string program_description =
+"This program measures the speed of the main kernels of the solver: the unit "
+"propagation (propagations per second), the search with conflict analysis "
+"(conflicts per second) and the variable heap (operations per second).\n"
+"The formulas are generated, always the same for the same seed: random 3-SAT "
+"at the phase transition, pigeonhole, parity chains and long chains of "
+"binary implications.\n"
+"Every measure is repeated after some warmup runs, and the result is printed "
+"in JSON format, with the mean, the median, the minimum, the maximum and the "
+"standard deviation of the rates, so two runs can be compared.\n"
+"Build with -DCMAKE_BUILD_TYPE=Release for meaningful numbers." ;
+
+namespace {
+
+struct Formula {
+    string name;
+    unsigned int variables;
+    vector<vector<Literal>> clauses;
+};
+
+// the generators use only the raw output of the engine, the distributions of
+// the standard library are not the same on every platform
+unsigned int pick(std::mt19937 &rng, unsigned int n) { return rng() % n; }
+
+Formula random_3sat(unsigned int n, uint32_t seed) {
+    Formula f{"random-3sat-" + std::to_string(n), n, {}};
+    std::mt19937 rng(seed);
+    // the hardest instances have 4.26 clauses for each variable
+    auto m = static_cast<size_t>(std::lround(4.26 * n));
+    for ( size_t i = 0; i < m; ++i ) {
+        vector<Literal> c;
+        while ( c.size() < 3 ) {
+            int v = static_cast<int>(pick(rng, n));
+            if ( std::any_of(c.begin(), c.end(),
+                        [v](Literal l) { return l.var() == unsigned(v); }) )
+                continue;
+            c.emplace_back(v, pick(rng, 2) == 1);
+        }
+        f.clauses.push_back(c);
+    }
+    return f;
+}
+
+// holes+1 pigeons in holes holes, unsatisfiable
+Formula pigeonhole(unsigned int holes) {
+    unsigned int pigeons = holes + 1;
+    Formula f{"pigeonhole-" + std::to_string(holes), pigeons * holes, {}};
+    auto in = [holes](unsigned int p, unsigned int h) {
+        return static_cast<int>(p * holes + h); };
+    for ( unsigned int p = 0; p < pigeons; ++p ) {
+        vector<Literal> c;
+        for ( unsigned int h = 0; h < holes; ++h ) c.emplace_back(in(p,h),false);
+        f.clauses.push_back(c);
+    }
+    for ( unsigned int h = 0; h < holes; ++h )
+        for ( unsigned int p = 0; p < pigeons; ++p )
+            for ( unsigned int q = p + 1; q < pigeons; ++q )
+                f.clauses.push_back({Literal(in(p,h),true),
+                        Literal(in(q,h),true)});
+    return f;
+}
+
+// y <-> a xor b
+void add_xor(Formula &f, int y, int a, int b) {
+    f.clauses.push_back({Literal(y,true), Literal(a,false), Literal(b,false)});
+    f.clauses.push_back({Literal(y,true), Literal(a,true), Literal(b,true)});
+    f.clauses.push_back({Literal(y,false), Literal(a,true), Literal(b,false)});
+    f.clauses.push_back({Literal(y,false), Literal(a,false), Literal(b,true)});
+}
+
+// the parity of n variables computed by two chains of xor, in two different
+// orders, must be both odd and even: unsatisfiable
+Formula parity_chains(unsigned int n, uint32_t seed) {
+    Formula f{"parity-" + std::to_string(n), n, {}};
+    vector<int> order(n);
+    for ( unsigned int i = 0; i < n; ++i ) order[i] = static_cast<int>(i);
+    std::mt19937 rng(seed);
+    for ( unsigned int i = n - 1; i > 0; --i )
+        std::swap(order[i], order[pick(rng, i + 1)]);
+
+    auto chain = [&f](const vector<int> &x) {
+        int y = x[0];
+        for ( size_t i = 1; i < x.size(); ++i ) {
+            int next = static_cast<int>(f.variables++);
+            add_xor(f, next, y, x[i]);
+            y = next;
+        }
+        return y;
+    };
+    vector<int> identity(n);
+    for ( unsigned int i = 0; i < n; ++i ) identity[i] = static_cast<int>(i);
+    int odd = chain(identity);
+    int even = chain(order);
+    f.clauses.push_back({Literal(odd,false)});
+    f.clauses.push_back({Literal(even,true)});
+    return f;
+}
+
+// chains of binary implications, the last variable of a chain implies the
+// first of the next one. A few random shortcuts join distant variables
+Formula binary_chains(unsigned int chains, unsigned int length,
+        uint32_t seed) {
+    unsigned int n = chains * length;
+    Formula f{"binary-chains-" + std::to_string(chains) + "x" +
+        std::to_string(length), n, {}};
+    for ( unsigned int v = 0; v + 1 < n; ++v )
+        f.clauses.push_back({Literal(static_cast<int>(v),true),
+                Literal(static_cast<int>(v+1),false)});
+    std::mt19937 rng(seed);
+    for ( unsigned int i = 0; i < n / 16; ++i ) {
+        unsigned int a = pick(rng, n), b = pick(rng, n);
+        if ( a < b )
+            f.clauses.push_back({Literal(static_cast<int>(a),true),
+                    Literal(static_cast<int>(b),false)});
+    }
+    return f;
+}
+
+void load(Satyricon::SATSolver &s, const Formula &f) {
+    s.set_log(0);
+    s.set_preprocessing(false);
+    s.set_number_of_variable(f.variables);
+    s.reserve_clauses(static_cast<unsigned int>(f.clauses.size()));
+    for ( auto c : f.clauses ) s.add_clause(c);
+}
+
+// work done by a run of a kernel, and its time
+struct Sample {
+    uint64_t work;
+    double seconds;
+};
+
+using Clock = std::chrono::steady_clock;
+
+double since(Clock::time_point t) {
+    return std::chrono::duration<double>(Clock::now() - t).count();
+}
+
+// random descents: decisions are propagated until a conflict or a complete
+// assignment, then the solver goes back to level 0. The work is the number
+// of propagated literals. The decisions follow a random order of the
+// variables from a random start, so picking them costs little
+Sample propagation_kernel(const Formula &f, uint32_t seed, uint64_t target) {
+    Satyricon::SATSolver s;
+    load(s, f);
+    std::mt19937 rng(seed);
+    vector<int> order(f.variables);
+    for ( unsigned int i = 0; i < f.variables; ++i )
+        order[i] = static_cast<int>(i);
+    for ( unsigned int i = f.variables - 1; i > 0; --i )
+        std::swap(order[i], order[pick(rng, i + 1)]);
+    uint64_t work = 0;
+
+    auto start = Clock::now();
+    while ( work < target ) {
+        size_t next = pick(rng, f.variables);
+        for ( size_t i = 0; i < order.size(); ++i ) {
+            Literal l(order[(next + i) % order.size()], pick(rng, 2) == 1);
+            if ( s.get_value(l) != Satyricon::LIT_UNASIGNED ) continue;
+            size_t before = s.get_assigned_variables();
+            bool conflict = s.propagate_literal(l);
+            work += s.get_assigned_variables() - before;
+            if ( conflict ) break;
+        }
+        if ( s.get_decision_level() == 0 ) break; // conflict at level 0
+        s.backtrack(0);
+    }
+    return {work, since(start)};
+}
+
+// search until the conflict budget is exhausted (or the formula is solved)
+Sample conflict_kernel(const Formula &f, uint32_t seed, uint64_t budget) {
+    Satyricon::SATSolver s;
+    load(s, f);
+    s.set_random_seed(seed);
+    uint64_t conflicts = 0;
+    s.set_terminate([&conflicts, budget]() { return ++conflicts >= budget; });
+
+    auto start = Clock::now();
+    s.solve();
+    double seconds = since(start);
+    // a formula solved at level 0 doesn't call the callback for the last
+    // conflict, it doesn't matter for the rate
+    return {conflicts, seconds};
+}
+
+// the operations of the decision heuristic: the activity of some variables
+// is increased, the most active variables are taken and then put back, as
+// after a backtrack. The work is the number of heap operations
+Sample heap_kernel(unsigned int n, uint32_t seed, uint64_t target) {
+    vector<double> activity(n, 0.0);
+    Satyricon::Variable_Heap heap(activity);
+    heap.set_size(n);
+    vector<Satyricon::var> vars(n);
+    for ( unsigned int v = 0; v < n; ++v ) vars[v] = v;
+    std::mt19937 rng(seed);
+    vector<Satyricon::var> taken;
+    uint64_t work = 0;
+    double bump = 1.0;
+
+    auto start = Clock::now();
+    heap.build(vars);
+    work += n;
+    while ( work < target ) {
+        for ( int i = 0; i < 64; ++i ) {
+            auto v = pick(rng, n);
+            activity[v] += bump;
+            heap.update(v);
+        }
+        bump *= 1.05;
+        if ( bump > 1e100 ) {
+            for ( auto &a : activity ) a *= 1e-100;
+            bump *= 1e-100;
+        }
+        for ( int i = 0; i < 32 && ! heap.empty(); ++i )
+            taken.push_back(heap.pop_max());
+        for ( auto v : taken ) heap.insert(v);
+        work += 64 + 2 * taken.size();
+        taken.clear();
+    }
+    return {work, since(start)};
+}
+
+struct Benchmark {
+    string kernel;
+    string instance;
+    string unit;
+    unsigned int variables;
+    size_t clauses;
+    std::function<Sample()> run;
+};
+
+struct Summary {
+    vector<double> rates;
+    uint64_t work;
+    double mean, median, min, max, stddev;
+};
+
+Summary measure(const Benchmark &b, unsigned int warmup,
+        unsigned int repetitions) {
+    for ( unsigned int i = 0; i < warmup; ++i ) b.run();
+
+    Summary s{};
+    for ( unsigned int i = 0; i < repetitions; ++i ) {
+        Sample r = b.run();
+        s.work = r.work;
+        s.rates.push_back(r.seconds > 0 ? r.work / r.seconds : 0.0);
+    }
+
+    vector<double> sorted = s.rates;
+    std::sort(sorted.begin(), sorted.end());
+    size_t n = sorted.size();
+    s.min = sorted.front();
+    s.max = sorted.back();
+    s.median = n % 2 ? sorted[n/2] : (sorted[n/2-1] + sorted[n/2]) / 2;
+    double sum = 0;
+    for ( auto r : sorted ) sum += r;
+    s.mean = sum / n;
+    double sq = 0;
+    for ( auto r : sorted ) sq += (r - s.mean) * (r - s.mean);
+    s.stddev = n > 1 ? std::sqrt(sq / (n - 1)) : 0.0;
+    return s;
+}
+
+void print_json(std::ostream &out, const vector<Benchmark> &benchmarks,
+        const vector<Summary> &results, unsigned int warmup,
+        unsigned int repetitions, uint32_t seed) {
+    out << std::fixed << std::setprecision(1);
+    out << "{\n";
+    out << "  \"warmup\": " << warmup << ",\n";
+    out << "  \"repetitions\": " << repetitions << ",\n";
+    out << "  \"seed\": " << seed << ",\n";
+#ifdef NDEBUG
+    out << "  \"assertions\": false,\n";
+#else
+    out << "  \"assertions\": true,\n";
+#endif
+    out << "  \"results\": [";
+    for ( size_t i = 0; i < benchmarks.size(); ++i ) {
+        const auto &b = benchmarks[i];
+        const auto &s = results[i];
+        out << (i == 0 ? "\n" : ",\n");
+        out << "    {\n";
+        out << "      \"kernel\": \"" << b.kernel << "\",\n";
+        out << "      \"instance\": \"" << b.instance << "\",\n";
+        out << "      \"variables\": " << b.variables << ",\n";
+        out << "      \"clauses\": " << b.clauses << ",\n";
+        out << "      \"unit\": \"" << b.unit << "\",\n";
+        out << "      \"work\": " << s.work << ",\n";
+        out << "      \"mean\": " << s.mean << ",\n";
+        out << "      \"median\": " << s.median << ",\n";
+        out << "      \"min\": " << s.min << ",\n";
+        out << "      \"max\": " << s.max << ",\n";
+        out << "      \"stddev\": " << s.stddev << ",\n";
+        out << "      \"samples\": [";
+        for ( size_t j = 0; j < s.rates.size(); ++j )
+            out << (j == 0 ? "" : ", ") << s.rates[j];
+        out << "]\n";
+        out << "    }";
+    }
+    out << "\n  ]\n}\n";
+}
+
+} // end anonymous namespace
+
+/**
+ * micro-benchmarks of the solver kernels
+ */
+int main(int argc, char* argv[])
+{
+    // ARGUMENT PARSING
+
+    ArgumentParser parser(
+            "micro-benchmarks of the SAT solver",
+            program_description);
+
+    auto& help = parser.make_flag("help",
+            "print this message and exit",{"h","help"});
+    auto& rep_opt = parser.make_option<unsigned int>("repetitions",
+            "measured runs of every benchmark (default 5)",
+            {"r","repetitions"});
+    auto& warm_opt = parser.make_option<unsigned int>("warmup",
+            "runs before the measure, not reported (default 1)",
+            {"w","warmup"});
+    auto& seed_opt = parser.make_option<unsigned int>("seed",
+            "seed of the generated formulas and of the searches (default 1)",
+            {"s","seed"});
+    auto& kernel_opt = parser.make_option<string>("kernel",
+            "run only one kernel: propagation, conflicts or heap",
+            {"k","kernel"});
+    auto& out_opt = parser.make_option<string>("output",
+            "write the JSON result in a file instead of the standard output",
+            {"o","output"});
+
+    try {
+        parser.parseCLI(argc,argv);
+    }
+    catch (Utils::ParsingException &e) {
+        cout << e.what() << endl;
+        cout << parser;
+        return 1;
+    }
+
+    if ( help ) {
+        cout << parser;
+        return 0;
+    }
+
+    unsigned int repetitions = rep_opt ? rep_opt.get_value() : 5;
+    unsigned int warmup = warm_opt ? warm_opt.get_value() : 1;
+    uint32_t seed = seed_opt ? seed_opt.get_value() : 1;
+    string only = kernel_opt ? kernel_opt.get_value() : "";
+    if ( repetitions == 0 ) {
+        cout << "ERROR: at least one repetition is needed\n";
+        return 1;
+    }
+    if ( ! only.empty() && only != "propagation" && only != "conflicts" &&
+            only != "heap" ) {
+        cout << "ERROR: unknown kernel " << only << "\n" << parser;
+        return 1;
+    }
+
+// -----------------------------------------------------------------------------
+
+    // BENCHMARKS
+
+    vector<Benchmark> benchmarks;
+
+    // propagation: big formulas, the search would take too long
+    const uint64_t propagations = 1 << 22;
+    for ( auto f : { random_3sat(100000, seed), pigeonhole(40),
+            parity_chains(20000, seed), binary_chains(16, 50000, seed) } ) {
+        auto formula = std::make_shared<Formula>(std::move(f));
+        benchmarks.push_back({"propagation", formula->name, "propagations/s",
+                formula->variables, formula->clauses.size(),
+                [formula, seed, propagations]() {
+                    return propagation_kernel(*formula, seed, propagations);
+                }});
+    }
+
+    // conflicts: small hard formulas, the search is stopped after a budget
+    const uint64_t conflicts = 20000;
+    for ( auto f : { random_3sat(300, seed), pigeonhole(10),
+            parity_chains(100, seed) } ) {
+        auto formula = std::make_shared<Formula>(std::move(f));
+        benchmarks.push_back({"conflicts", formula->name, "conflicts/s",
+                formula->variables, formula->clauses.size(),
+                [formula, seed, conflicts]() {
+                    return conflict_kernel(*formula, seed, conflicts);
+                }});
+    }
+
+    const uint64_t heap_ops = 1 << 24;
+    for ( unsigned int n : { 1u << 12, 1u << 20 } )
+        benchmarks.push_back({"heap", "variables-" + std::to_string(n),
+                "operations/s", n, 0,
+                [n, seed, heap_ops]() {
+                    return heap_kernel(n, seed, heap_ops);
+                }});
+
+    if ( ! only.empty() )
+        benchmarks.erase(std::remove_if(benchmarks.begin(), benchmarks.end(),
+                    [&only](const Benchmark &b) { return b.kernel != only; }),
+                benchmarks.end());
+
+    vector<Summary> results;
+    for ( const auto &b : benchmarks ) {
+        cerr << b.kernel << " " << b.instance << "... " << std::flush;
+        results.push_back(measure(b, warmup, repetitions));
+        cerr << std::fixed << std::setprecision(0) << results.back().median <<
+            " " << b.unit << endl;
+    }
+
+    if ( out_opt ) {
+        std::ofstream out(out_opt.get_value());
+        if ( ! out ) {
+            cout << "ERROR: can't open " << out_opt.get_value() << "\n";
+            return 1;
+        }
+        print_json(out, benchmarks, results, warmup, repetitions, seed);
+    }
+    else
+        print_json(cout, benchmarks, results, warmup, repetitions, seed);
+    return 0;
+}
@@ -0,0 +1,475 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <dirent.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "ArgumentParser.hpp"
+#include "cnf_formula.hpp"
+#include "dimacs_parser.hpp"
+#include "sat_solver.hpp"
+
+using std::cout; using std::endl;
+using std::string; using std::vector;
+using Utils::ArgumentParser;
+
+// description of program, both for documenation and help message
+std::string program_description =
+"This program runs the solver on all the formulas of a directory (the files "
+"with .cnf in the name, also compressed) and writes a CSV file with the "
+"status, the time, the conflicts and the propagations of every instance.\n"
+"The instances run in parallel, one for each core, each one in its own "
+"process with a wall-clock limit and a memory limit. The models of the "
+"satisfiable instances are verified against the original clauses.\n"
+"The suite is scored by PAR-2: the time of the solved instances, plus two "
+"times the time limit for each unsolved one. With a baseline (the CSV of a "
+"previous run) the program reports the instances solved by the baseline and "
+"not anymore, the answers that disagree, and the instances that became "
+"slower than the baseline by more than the slowdown factor (and by more "
+"than one second).\n"
+"The exit code is 1 if a model is wrong or an answer disagrees with the "
+"baseline." ;
+
+namespace {
+
+// statuses of an instance in the CSV
+const char *SAT = "SAT";         // a verified model
+const char *UNSAT = "UNSAT";
+const char *TIMEOUT = "TIMEOUT";
+const char *MEMOUT = "MEMOUT";
+const char *WRONG = "WRONG";     // a model that doesn't satisfy the formula
+const char *ERROR = "ERROR";     // unreadable input or a crash
+
+// differences of time smaller than this are noise
+const double min_slowdown = 1.0;
+
+struct Result {
+    string instance;
+    string status;
+    double time;
+    uint64_t conflicts;
+    uint64_t propagations;
+};
+
+bool solved(const string &status) { return status == SAT || status == UNSAT; }
+
+using Clock = std::chrono::steady_clock;
+
+double since(Clock::time_point t) {
+    return std::chrono::duration<double>(Clock::now() - t).count();
+}
+
+// the formulas of a directory, by name
+vector<string> list_instances(const string &directory) {
+    DIR *dir = opendir(directory.c_str());
+    if ( dir == nullptr )
+        throw std::runtime_error("can't open the directory " + directory +
+                ": " + std::strerror(errno));
+    vector<string> names;
+    while ( dirent *entry = readdir(dir) ) {
+        string name = entry->d_name;
+        if ( name.find(".cnf") == string::npos ) continue;
+        struct stat info;
+        if ( stat((directory + "/" + name).c_str(), &info) == 0 &&
+                S_ISREG(info.st_mode) )
+            names.push_back(name);
+    }
+    closedir(dir);
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+/**
+ * Solve an instance in the child process, and write the result on the pipe
+ * as "status time conflicts propagations". The search is interrupted at the
+ * time limit, the memory limit make an allocation fail.
+ */
+void solve_instance(const string &path, double timeout, size_t memory,
+        int out) {
+    if ( memory > 0 ) {
+        rlimit limit;
+        limit.rlim_cur = limit.rlim_max = memory;
+        setrlimit(RLIMIT_AS, &limit);
+    }
+
+    auto start = Clock::now();
+    string status = ERROR;
+    uint64_t conflicts = 0, propagations = 0;
+    try {
+        Satyricon::CNF_Formula formula;
+        Satyricon::parse_file(formula, path);
+
+        Satyricon::SATSolver solver;
+        solver.set_log(0);
+        // the other cores run the other instances
+        solver.set_preprocessing_threads(1);
+        std::atomic<bool> stop(false);
+        solver.set_interrupt(&stop);
+        solver.set_number_of_variable(formula.get_number_of_variable());
+        solver.reserve_clauses(
+                static_cast<unsigned int>(formula.get_clauses().size()));
+        bool conflict = false;
+        for ( auto c : formula.get_clauses() )
+            if ( solver.add_clause(c) ) { conflict = true; break; }
+
+        // the timer stop the search at the time limit
+        std::mutex mutex;
+        std::condition_variable finished;
+        bool done = false;
+        std::thread timer([&]() {
+            std::unique_lock<std::mutex> lock(mutex);
+            auto limit = start + std::chrono::duration_cast<Clock::duration>(
+                    std::chrono::duration<double>(timeout));
+            if ( ! finished.wait_until(lock, limit, [&]() { return done; }) )
+                stop = true;
+        });
+
+        bool sat = ! conflict && solver.solve();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            done = true;
+        }
+        finished.notify_one();
+        timer.join();
+
+        if ( solver.interrupted() ) status = TIMEOUT;
+        else if ( ! sat ) status = UNSAT;
+        else status = formula.satisfied_by(solver.get_model()) ? SAT : WRONG;
+        conflicts = solver.get_conflicts();
+        propagations = solver.get_propagations();
+    }
+    // the clause arena has a size limit too
+    catch ( const std::bad_alloc & ) {
+        status = MEMOUT;
+    }
+    catch ( const std::length_error & ) {
+        status = MEMOUT;
+    }
+    // without memory a thread can't be created
+    catch ( const std::system_error &e ) {
+        status = e.code() == std::errc::resource_unavailable_try_again ||
+            e.code() == std::errc::not_enough_memory ? MEMOUT : ERROR;
+    }
+    catch ( const std::exception & ) {
+        status = ERROR;
+    }
+
+    std::ostringstream message;
+    message << status << " " << since(start) << " " << conflicts << " " <<
+        propagations << "\n";
+    string m = message.str();
+    ssize_t written = write(out, m.data(), m.size());
+    (void)written; // a closed pipe is a crash for the parent
+}
+
+// a child process running an instance
+struct Job {
+    size_t index;
+    pid_t pid;
+    int pipe;
+    Clock::time_point start;
+    bool killed;
+};
+
+// read the result of a terminated child
+Result collect(const Job &job, const string &instance, int wait_status,
+        double timeout) {
+    Result r{instance, ERROR, since(job.start), 0, 0};
+    string message;
+    char buffer[256];
+    ssize_t n;
+    while ( (n = read(job.pipe, buffer, sizeof(buffer))) > 0 )
+        message.append(buffer, static_cast<size_t>(n));
+    close(job.pipe);
+
+    std::istringstream in(message);
+    double time;
+    string status;
+    if ( WIFEXITED(wait_status) && in >> status >> time >> r.conflicts >>
+            r.propagations ) {
+        r.status = status;
+        r.time = time;
+    }
+    else if ( job.killed )
+        r.status = TIMEOUT;
+
+    if ( r.status == TIMEOUT ) r.time = timeout;
+    return r;
+}
+
+/**
+ * Run all the instances, at most jobs at the same time. A child is killed if
+ * it doesn't stop a few seconds after the time limit.
+ */
+vector<Result> run_suite(const string &directory,
+        const vector<string> &instances, unsigned int jobs, double timeout,
+        size_t memory) {
+    vector<Result> results(instances.size());
+    vector<Job> running;
+    size_t next = 0;
+    size_t completed = 0;
+    double grace = 5.0 + timeout / 10;
+
+    while ( completed < instances.size() ) {
+        while ( running.size() < jobs && next < instances.size() ) {
+            int fd[2];
+            if ( pipe(fd) != 0 )
+                throw std::runtime_error(string("pipe: ") +
+                        std::strerror(errno));
+            cout.flush();
+            pid_t pid = fork();
+            if ( pid < 0 )
+                throw std::runtime_error(string("fork: ") +
+                        std::strerror(errno));
+            if ( pid == 0 ) {
+                close(fd[0]);
+                solve_instance(directory + "/" + instances[next], timeout,
+                        memory, fd[1]);
+                _exit(0);
+            }
+            close(fd[1]);
+            running.push_back({next, pid, fd[0], Clock::now(), false});
+            ++next;
+        }
+
+        bool reaped = false;
+        for ( auto it = running.begin(); it != running.end(); ) {
+            int wait_status;
+            pid_t p = waitpid(it->pid, &wait_status, WNOHANG);
+            if ( p == it->pid ) {
+                const string &name = instances[it->index];
+                results[it->index] = collect(*it, name, wait_status, timeout);
+                const Result &r = results[it->index];
+                ++completed;
+                cout << "[" << completed << "/" << instances.size() << "] " <<
+                    name << " " << r.status << " " << std::fixed <<
+                    std::setprecision(2) << r.time << "s" << endl;
+                it = running.erase(it);
+                reaped = true;
+                continue;
+            }
+            if ( ! it->killed && since(it->start) > timeout + grace ) {
+                kill(it->pid, SIGKILL);
+                it->killed = true;
+            }
+            ++it;
+        }
+        if ( ! reaped )
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return results;
+}
+
+void write_csv(std::ostream &out, const vector<Result> &results) {
+    out << "instance,status,time,conflicts,propagations\n";
+    out << std::fixed << std::setprecision(3);
+    for ( const auto &r : results )
+        out << r.instance << "," << r.status << "," << r.time << "," <<
+            r.conflicts << "," << r.propagations << "\n";
+}
+
+// the results of a previous run, by instance
+std::map<string, Result> read_csv(const string &file_name) {
+    std::ifstream in(file_name);
+    if ( ! in )
+        throw std::runtime_error("can't open the baseline " + file_name);
+    std::map<string, Result> results;
+    string line;
+    std::getline(in, line); // header
+    while ( std::getline(in, line) ) {
+        if ( line.empty() ) continue;
+        std::istringstream fields(line);
+        Result r{};
+        string time, conflicts, propagations;
+        if ( ! std::getline(fields, r.instance, ',') ||
+                ! std::getline(fields, r.status, ',') ||
+                ! std::getline(fields, time, ',') ||
+                ! std::getline(fields, conflicts, ',') ||
+                ! std::getline(fields, propagations, ',') )
+            throw std::runtime_error("malformed baseline line: " + line);
+        r.time = std::stod(time);
+        r.conflicts = std::stoull(conflicts);
+        r.propagations = std::stoull(propagations);
+        results[r.instance] = r;
+    }
+    return results;
+}
+
+double par2(const Result &r, double timeout) {
+    return solved(r.status) ? r.time : 2 * timeout;
+}
+
+} // end anonymous namespace
+
+/**
+ * benchmark suite from CLI
+ */
+int main(int argc, char* argv[])
+{
+    // ARGUMENT PARSING
+
+    ArgumentParser parser(
+            "benchmark suite runner of the SAT solver",
+            program_description);
+
+    auto& directory = parser.make_positional<string>("directory",
+            "directory of the formulas (in DIMACS format)" );
+
+    auto& help = parser.make_flag("help",
+            "print this message and exit",{"h","help"});
+    auto& jobs_opt = parser.make_option<unsigned int>("jobs",
+            "instances solved at the same time (default one for each core)",
+            {"j","jobs"});
+    auto& timeout_opt = parser.make_option<double>("seconds",
+            "wall-clock limit of an instance (default 300)",
+            {"t","timeout"});
+    auto& memory_opt = parser.make_option<unsigned int>("megabytes",
+            "memory limit of an instance, 0 for no limit (default 4096)",
+            {"m","memory"});
+    auto& out_opt = parser.make_option<string>("output file",
+            "file of the results (default suite.csv)", {"o","output"});
+    auto& baseline_opt = parser.make_option<string>("baseline file",
+            "results of a previous run, to find the regressions",
+            {"b","baseline"});
+    auto& slowdown_opt = parser.make_option<double>("factor",
+            "an instance is slower than the baseline if its time is more "
+            "than factor times the time of the baseline (default 1.5)",
+            {"slowdown"});
+
+    try {
+        parser.parseCLI(argc,argv);
+    }
+    catch (Utils::ParsingException &e) {
+        cout << e.what() << endl;
+        cout << parser;
+        return 1;
+    }
+
+    if ( help ) {
+        cout << parser;
+        return 0;
+    }
+
+    if ( ! directory ) {
+        cout << "ERROR: the directory of the formulas is required\n" << parser;
+        return 1;
+    }
+
+    unsigned int jobs = jobs_opt ? jobs_opt.get_value() :
+        std::thread::hardware_concurrency();
+    if ( jobs == 0 ) jobs = 1;
+    double timeout = timeout_opt ? timeout_opt.get_value() : 300.0;
+    size_t memory = (memory_opt ? memory_opt.get_value() : 4096u) *
+        static_cast<size_t>(1 << 20);
+    string output = out_opt ? out_opt.get_value() : "suite.csv";
+    double slowdown = slowdown_opt ? slowdown_opt.get_value() : 1.5;
+    if ( timeout <= 0 || slowdown <= 0 ) {
+        cout << "ERROR: the time limit and the slowdown must be positive\n";
+        return 1;
+    }
+
+// -----------------------------------------------------------------------------
+
+    // SUITE
+
+    vector<Result> results;
+    std::map<string, Result> baseline;
+    try {
+        if ( baseline_opt ) baseline = read_csv(baseline_opt.get_value());
+        auto instances = list_instances(directory.get_value());
+        if ( instances.empty() ) {
+            cout << "ERROR: no formula in " << directory.get_value() << "\n";
+            return 1;
+        }
+        cout << instances.size() << " instances, " << jobs << " jobs" << endl;
+        results = run_suite(directory.get_value(), instances, jobs, timeout,
+                memory);
+    }
+    catch (const std::exception& e) {
+        cout << "ERROR: " << e.what() << endl;
+        return 1;
+    }
+
+    std::ofstream csv(output);
+    if ( ! csv ) {
+        cout << "ERROR: can't write " << output << endl;
+        return 1;
+    }
+    write_csv(csv, results);
+
+    // SUMMARY
+
+    bool failed = false;
+    std::map<string, unsigned int> count;
+    double score = 0;
+    for ( const auto &r : results ) {
+        count[r.status]++;
+        score += par2(r, timeout);
+        if ( r.status == WRONG ) {
+            cout << "WRONG MODEL: " << r.instance << "\n";
+            failed = true;
+        }
+    }
+    cout << std::fixed << std::setprecision(2);
+    cout << "solved: " << count[SAT] + count[UNSAT] << " of " <<
+        results.size() << " (" << count[SAT] << " SAT, " << count[UNSAT] <<
+        " UNSAT)\n";
+    for ( auto s : { TIMEOUT, MEMOUT, WRONG, ERROR } )
+        if ( count[s] > 0 ) cout << s << ": " << count[s] << "\n";
+    cout << "PAR-2: " << score << " (average " << score / results.size() <<
+        ")\n";
+
+    if ( baseline_opt ) {
+        double base_score = 0, common_score = 0;
+        unsigned int slower = 0, lost = 0;
+        for ( const auto &r : results ) {
+            auto it = baseline.find(r.instance);
+            if ( it == baseline.end() ) continue;
+            const Result &b = it->second;
+            base_score += par2(b, timeout);
+            common_score += par2(r, timeout);
+
+            if ( solved(r.status) && solved(b.status) &&
+                    r.status != b.status ) {
+                cout << "DISAGREE: " << r.instance << " " << r.status <<
+                    ", baseline " << b.status << "\n";
+                failed = true;
+            }
+            else if ( solved(b.status) && ! solved(r.status) ) {
+                cout << "UNSOLVED: " << r.instance << " " << r.status <<
+                    ", baseline " << b.status << " in " << b.time << "s\n";
+                ++lost;
+            }
+            else if ( solved(r.status) && solved(b.status) &&
+                    r.time > slowdown * b.time &&
+                    r.time - b.time > min_slowdown ) {
+                cout << "SLOWER: " << r.instance << " " << r.time <<
+                    "s, baseline " << b.time << "s (x" <<
+                    r.time / b.time << ")\n";
+                ++slower;
+            }
+        }
+        cout << "PAR-2 on the instances of the baseline: " << common_score <<
+            ", baseline " << base_score << "\n";
+        cout << "slower: " << slower << ", unsolved: " << lost << "\n";
+    }
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,117 @@
+#include <chrono>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include "ArgumentParser.hpp"
+#include "dimacs_parser.hpp"
+#include "drat_checker.hpp"
+
+using std::exception;
+using std::cout; using std::endl;
+using std::string; using std::to_string;
+using Utils::ArgumentParser;
+
+// description of program, both for documenation and help message
+std::string program_description =
+"This program checks a DRAT proof of unsatisfiability of a formula in "
+"DIMACS format, like the ones written by the solver with the --drat option. "
+"The proof can be in the binary or in the textual format, the format is "
+"detected automatically.\n"
+"The check is backward: it starts from the empty clause, and only the "
+"lemmas used to derive it are checked, by reverse unit propagation. The "
+"checks of different lemmas run in parallel. At the end the program reports "
+"the number of checked lemmas and the size of the trimmed core, the clauses "
+"of the formula used by the proof.\n"
+"RAT lemmas are not supported." ;
+
+/**
+ * DRAT checker from CLI
+ */
+int main(int argc, char* argv[])
+{
+    // ARGUMENT PARSING
+
+    // parsing set up
+    ArgumentParser parser(
+            "DRAT proof checker",
+            program_description);
+
+    auto& in = parser.make_positional<string>("input",
+            "formula (in DIMACS format)" );
+    auto& proof_file = parser.make_positional<string>("proof",
+            "DRAT proof of the unsatisfiability of the formula" );
+
+    // print help
+    auto& help = parser.make_flag("help",
+            "print this message and exit",{"h","help"});
+
+    unsigned int threads = 0;
+    auto& threads_opt = parser.make_option<unsigned int>("threads",
+            "number of checking threads (default one for each core)",
+            {"t","threads"});
+
+    // parsing argument
+    try {
+        parser.parseCLI(argc,argv);
+    }
+    catch (Utils::ParsingException &e) {
+        cout << e.what() << endl;
+        cout << parser;
+        return 1;
+    }
+
+    if ( help ) {
+        cout << parser;
+        return 0;
+    }
+
+    if ( ! in || ! proof_file ) {
+        cout << "ERROR: both the formula and the proof are required\n"
+            << parser;
+        return 1;
+    }
+    if ( threads_opt ) threads = threads_opt.get_value();
+
+// -----------------------------------------------------------------------------
+
+    // CHECKER
+
+    auto start = std::chrono::steady_clock::now();
+    Satyricon::DRAT_Checker checker(threads);
+    try {
+        Satyricon::parse_file(checker, in.get_value());
+        checker.read_proof(proof_file.get_value());
+    }
+    catch (const exception& e) {
+        cout << "Error parsing the input: " << e.what() << endl;
+        return 1;
+    }
+
+    auto read_time = std::chrono::steady_clock::now();
+    std::chrono::duration<double> elapsed = read_time - start;
+    cout << "read formula and proof in: " << std::fixed <<
+        std::setprecision(2) << elapsed.count() << "s\n";
+
+    bool correct = checker.check();
+
+    auto end_time = std::chrono::steady_clock::now();
+    elapsed = end_time - read_time;
+    cout << "checked in: " << std::fixed << std::setprecision(2) <<
+        elapsed.count() << "s\n";
+
+    cout << "checked lemmas: " << checker.checked_lemmas() << " of " <<
+        checker.proof_lemmas() << "\n";
+    cout << "core: " << checker.core_size() << " of " <<
+        checker.formula_size() << " clauses\n";
+    if ( checker.ignored_deletions() > 0 )
+        cout << "ignored deletions: " << checker.ignored_deletions() << "\n";
+
+    if ( ! correct ) {
+        cout << checker.error() << "\n";
+        cout << "NOT VERIFIED" << endl;
+        return 1;
+    }
+    cout << "VERIFIED" << endl;
+    return 0;
+}
@@ -0,0 +1,54 @@
+#ifndef SATYRICON_CLAUSE_EXCHANGE_HPP
+#define SATYRICON_CLAUSE_EXCHANGE_HPP
+
+#include <array>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "solver_types.hpp"
+
+namespace Satyricon {
+
+/**
+ * Lock free exchange of learned clauses between solvers on different threads.
+ * It is a ring buffer of fixed size slots: every producer reserve a slot with
+ * an atomic ticket, and every consumer read the slots after its own cursor.
+ * Each slot has a sequence number (odd while it is written) used to detect
+ * the slots overwritten during a read. The exchange is best effort, a
+ * clause can be lost if a consumer fall behind by more than the capacity.
+ */
+class Clause_Exchange {
+public:
+    // maximum number of literals of an exchanged clause
+    static const size_t max_clause_size = 32;
+
+    explicit Clause_Exchange(size_t capacity = 1 << 14);
+
+    // publish a clause, false if it is too long or the slot is busy
+    bool publish(unsigned int producer, const std::vector<Literal> &c);
+
+    // call f for every clause published by other producers after cursor,
+    // and update the cursor. Return the number of imported clauses
+    size_t collect(unsigned int consumer, uint64_t &cursor,
+            const std::function<void(std::vector<Literal>&)> &f);
+
+    // total number of published clauses
+    uint64_t published() const { return head.load(std::memory_order_relaxed); }
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> sequence;
+        std::atomic<uint32_t> producer;
+        std::atomic<uint32_t> size;
+        std::array<std::atomic<uint32_t>, max_clause_size> literals;
+    };
+
+    std::unique_ptr<Slot[]> slots;
+    size_t capacity;
+    std::atomic<uint64_t> head;
+};
+
+} // end namespace Satyricon
+
+#endif
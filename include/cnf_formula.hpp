@@ -0,0 +1,56 @@
+#ifndef SATYRICON_CNF_FORMULA_HPP
+#define SATYRICON_CNF_FORMULA_HPP
+
+#include <vector>
+#include "solver_types.hpp"
+
+namespace Satyricon {
+
+/**
+ * A formula as it is read, without any simplification. It has the same
+ * interface of SATSolver for the formula construction, so it can be filled
+ * by the parser and then given to a solver, and it is used to verify the
+ * models of the solver against the original clauses.
+ */
+class CNF_Formula {
+public:
+    CNF_Formula() : number_of_variable(0), clauses() {}
+
+    void set_number_of_variable(unsigned int n) { number_of_variable = n; }
+    void reserve_clauses(unsigned int n) { clauses.reserve(n); }
+    // an empty clause is kept, the formula is unsatisfiable
+    bool add_clause(std::vector<Literal> &c) {
+        clauses.push_back(c);
+        return false;
+    }
+
+    unsigned int get_number_of_variable() const { return number_of_variable; }
+    const std::vector<std::vector<Literal>> &get_clauses() const {
+        return clauses;
+    }
+
+    // true if every clause has a true literal in the model (in the format of
+    // SATSolver::get_model, a DIMACS literal for each variable)
+    bool satisfied_by(const std::vector<int> &model) const {
+        for ( const auto &c : clauses ) {
+            bool satisfied = false;
+            for ( auto l : c ) {
+                if ( l.var() >= model.size() ) continue;
+                if ( (model[l.var()] < 0) == l.sign() ) {
+                    satisfied = true;
+                    break;
+                }
+            }
+            if ( ! satisfied ) return false;
+        }
+        return true;
+    }
+
+private:
+    unsigned int number_of_variable;
+    std::vector<std::vector<Literal>> clauses;
+};
+
+} // end namespace Satyricon
+
+#endif
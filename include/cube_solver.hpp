@@ -0,0 +1,107 @@
+#ifndef SATYRICON_CUBE_SOLVER_HPP
+#define SATYRICON_CUBE_SOLVER_HPP
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "clause_exchange.hpp"
+#include "sat_solver.hpp"
+
+namespace Satyricon {
+
+/**
+ * Cube and conquer solver.
+ * A lookahead phase split the formula in many cubes (partial assignments),
+ * choosing the splitting variables with the number of literals implied by
+ * their propagation. The cubes are then solved by a pool of workers, every
+ * worker keeps a single SATSolver and solve each cube under assumptions. An
+ * idle worker steal the cubes from the queue of the others.
+ * The formula is satisfiable iff a cube is satisfiable.
+ */
+class CubeSolver {
+public:
+
+    explicit CubeSolver(unsigned int number_of_workers);
+
+    // same interface of SATSolver for the problem construction, every
+    // clause is added to all the workers
+    void set_number_of_variable(unsigned int n);
+    void reserve_clauses(unsigned int n);
+    bool add_clause(std::vector<Literal>& c);
+
+    // access the solver of a worker, useful for the configuration
+    SATSolver& operator [] (size_t i) { return *workers[i]; }
+    size_t size() const { return workers.size(); }
+
+    // maximum number of splitting decisions in a cube
+    void set_depth(unsigned int d);
+    // a cube is not split anymore when this fraction of the variables is
+    // assigned
+    void set_cutoff(double c);
+    // number of variables evaluated by the lookahead at every split
+    void set_candidates(unsigned int c);
+
+    // enable or disable the exchange of learned clauses between the workers
+    // (enabled by default)
+    void set_clause_sharing(bool s);
+
+    // split the formula and solve all the cubes, return true iff the
+    // problem is satisfiable
+    bool solve();
+
+    // number of generated cubes, and of cubes found unsatisfiable
+    size_t get_cubes() const { return cubes.size(); }
+    size_t get_refuted_cubes() const { return refuted; }
+
+    // index of the worker that found the answer
+    size_t get_winner() const { return winner; }
+
+    // if the formula is satisfiable, return the model
+    const std::vector<int>& get_model();
+
+    // return a printable version of the model.
+    std::string string_model();
+
+private:
+    // cubes waiting for a worker, the owner take them from the front and
+    // the thieves from the back
+    struct Work_Queue {
+        std::mutex mutex;
+        std::deque<size_t> cubes;
+    };
+
+    // lookahead phase, generate the cubes with the solver s
+    void split(SATSolver &s, std::vector<Literal> &cube, unsigned int depth);
+    void select_candidates(SATSolver &s, std::vector<int> &candidates);
+
+    // conquer phase, executed by every worker
+    void conquer(size_t id);
+    bool next_cube(size_t id, size_t &cube);
+
+    std::vector<std::unique_ptr<SATSolver> > workers;
+    std::unique_ptr<Clause_Exchange> exchange;
+    std::vector<Literal> clause_copy;
+
+    // lookahead parameters
+    unsigned int max_depth;
+    double cutoff;
+    unsigned int number_of_candidates;
+
+    // variables ordered by activity, the candidates are the first unassigned
+    std::vector<int> ranking;
+
+    std::vector<std::vector<Literal> > cubes;
+    std::unique_ptr<Work_Queue[]> queues;
+
+    std::atomic<bool> stop;
+    std::atomic<bool> satisfiable;
+    std::atomic<size_t> refuted;
+    size_t winner;
+};
+
+} // end namespace Satyricon
+
+#endif
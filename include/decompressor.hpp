@@ -0,0 +1,74 @@
+#ifndef SATYRICON_DECOMPRESSOR_HPP
+#define SATYRICON_DECOMPRESSOR_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Satyricon {
+
+/**
+ * Compression format of an input, detected from the magic bytes
+ */
+enum compression_format {
+    COMPRESSION_NONE,
+    COMPRESSION_GZIP,
+    COMPRESSION_XZ,
+    COMPRESSION_BZIP2
+};
+
+// number of bytes required to detect the compression format
+static const size_t compression_magic_size = 6;
+
+// detect the compression format from the first bytes of an input
+compression_format detect_compression(const char *data, size_t size);
+
+// read(buffer, size) fill the buffer and return the number of bytes, 0 at
+// the end of the input
+using Read_Function = std::function<size_t(char*,size_t)>;
+// write(buffer, size) consume the buffer, return false to stop the process
+using Write_Function = std::function<bool(const char*,size_t)>;
+
+// decompress all the input in blocks. Throw a std::domain_error if the
+// input is corrupted or the format is not supported by this build
+void decompress(compression_format format, const Read_Function &in,
+        const Write_Function &out);
+
+/**
+ * Decompress an input on a background thread. The decompressed text is read
+ * with read(), only a few blocks are kept in memory so the decompression
+ * never gets too far ahead of the reader.
+ */
+class Decompression_Thread {
+public:
+    Decompression_Thread(compression_format format, Read_Function in);
+    ~Decompression_Thread();
+
+    Decompression_Thread(const Decompression_Thread&) = delete;
+    Decompression_Thread& operator=(const Decompression_Thread&) = delete;
+
+    // same semantic of Read_Function, rethrow the decompression errors
+    size_t read(char *buffer, size_t size);
+
+private:
+    // called by the decompression thread, false if the reader is gone
+    bool push(const char *data, size_t size);
+    void finish(std::exception_ptr error);
+
+    std::mutex mutex;
+    std::condition_variable not_empty, not_full;
+    std::deque<std::vector<char> > blocks;
+    std::vector<char> current;
+    size_t current_pos;
+    bool completed, cancelled;
+    std::exception_ptr error;
+    std::thread worker;
+};
+
+} // end namespace Satyricon
+
+#endif
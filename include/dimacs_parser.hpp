@@ -3,13 +3,38 @@
 
 #include <string>
 #include <vector>
+#include "cnf_formula.hpp"
+#include "cube_solver.hpp"
+#include "drat_checker.hpp"
+#include "portfolio.hpp"
 #include "sat_solver.hpp"
 
 namespace Satyricon {
 
-// initialize a solver with all the clause in a DIMACS file
+// initialize a solver with all the clause in a DIMACS file. A gzip, xz or
+// bzip2 input is detected and decompressed on the fly
 bool parse_file( SATSolver& solver, std::istream &in);
 
+// same as above, but read the file directly: a regular file is mapped in
+// memory, anything else is read in big blocks. "-" is the standard input
+bool parse_file( SATSolver& solver, const std::string &file_name);
+
+// load the problem in all the solvers of a portfolio, parsing it only once
+bool parse_file( PortfolioSolver& solver, std::istream &in);
+bool parse_file( PortfolioSolver& solver, const std::string &file_name);
+
+// load the problem in all the workers of a cube and conquer solver
+bool parse_file( CubeSolver& solver, std::istream &in);
+bool parse_file( CubeSolver& solver, const std::string &file_name);
+
+// load the formula of a proof in the checker
+bool parse_file( DRAT_Checker& checker, std::istream &in);
+bool parse_file( DRAT_Checker& checker, const std::string &file_name);
+
+// read the formula without solving it
+bool parse_file( CNF_Formula& formula, std::istream &in);
+bool parse_file( CNF_Formula& formula, const std::string &file_name);
+
 } // end namespace Satyricon
 
 #endif
\ No newline at end of file
@@ -0,0 +1,127 @@
+#ifndef SATYRICON_DRAT_CHECKER_HPP
+#define SATYRICON_DRAT_CHECKER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "solver_types.hpp"
+
+namespace Satyricon {
+
+/**
+ * Backward checker of DRAT proofs (binary or textual format).
+ * Every clause of the formula and of the proof is stored once in a
+ * Clause_Allocator, with the interval of proof steps in which it is active.
+ * The check starts from the empty clause: a lemma is checked by reverse unit
+ * propagation against the clauses active when it was added, and the clauses
+ * used to find the conflict are marked. Only the marked lemmas are checked,
+ * and the marked clauses of the formula are the trimmed core.
+ * The checks of different lemmas are independent, so they run on many
+ * threads, each one with its own assignment and watch lists. The
+ * propagation visits the marked clauses first (core first), to keep the
+ * core small. Only RUP lemmas are accepted, RAT lemmas are not checked.
+ */
+class DRAT_Checker {
+public:
+    // 0 threads means one for each core
+    explicit DRAT_Checker(unsigned int threads);
+    ~DRAT_Checker();
+
+    DRAT_Checker(const DRAT_Checker&) = delete;
+    DRAT_Checker& operator=(const DRAT_Checker&) = delete;
+
+    // same interface of SATSolver for the formula construction
+    void set_number_of_variable(unsigned int n);
+    void reserve_clauses(unsigned int n);
+    bool add_clause(std::vector<Literal> &c);
+
+    // read a proof, the format is detected from the first bytes. Throw a
+    // std::runtime_error if the file can't be read or is malformed
+    void read_proof(const std::string &file_name);
+
+    // check the proof, return true if it is correct
+    bool check();
+
+    // statistics of the last check
+    size_t formula_size() const { return formula_clauses; }
+    size_t core_size() const { return core; }
+    size_t proof_lemmas() const { return lemmas; }
+    size_t checked_lemmas() const { return checked; }
+    // deletions of clauses that are not in the formula, they are ignored
+    size_t ignored_deletions() const { return ignored; }
+    // description of the first lemma that failed the check
+    const std::string &error() const { return failure; }
+
+private:
+    static const uint32_t NEVER = UINT32_MAX;
+
+    // assignment and watch lists of a checking thread
+    struct Worker;
+
+    // a clause is active after the step of its addition, until the step of
+    // its deletion. The formula is added at step 0
+    uint32_t new_clause(std::vector<Literal> &c, uint32_t step);
+    void delete_clause(std::vector<Literal> &c, uint32_t step);
+    uint64_t clause_hash(const std::vector<Literal> &c) const;
+
+    bool is_active(uint32_t c, uint32_t step) const {
+        return added[c] < step && deleted[c] > step;
+    }
+
+    // mark a clause as part of the proof, a lemma must be checked
+    void mark(uint32_t c);
+
+    // check all the marked lemmas, until the queue is empty
+    void worker_loop(Worker &w);
+    bool check_lemma(Worker &w, uint32_t lemma);
+
+    // propagate the assignment of a worker with the clauses active at step,
+    // the marked clauses first. Return the conflict clause, or NEVER
+    uint32_t propagate(Worker &w, uint32_t step);
+    uint32_t propagate_literal(Worker &w, Literal p, uint32_t step,
+            bool core_only);
+
+    Clause_Allocator ca;
+    std::vector<CRef> refs;          // clause index -> clause in the arena
+    std::vector<uint32_t> added;     // step of the addition
+    std::vector<uint32_t> deleted;   // step of the deletion, or NEVER
+    std::vector<uint32_t> units;     // clauses of a single literal
+    // the deleted clauses, the last deleted first: going backward, a
+    // worker watches a clause only from the step of its deletion
+    std::vector<uint32_t> by_deletion;
+    unsigned int number_of_variable;
+    unsigned int threads;
+
+    // the clauses not yet deleted, by the hash of their sorted literals
+    std::unordered_multimap<uint64_t, uint32_t> alive;
+
+    size_t formula_clauses;
+    uint32_t steps;
+    // first empty clause of the proof (or of the formula), it is the final
+    // conflict
+    uint32_t empty_clause;
+
+    // marked clauses, and the marked lemmas still to check (a heap, the
+    // last ones first). The lemmas of the running checks can only mark
+    // older lemmas, so the clauses added after the last running lemma are
+    // never active again
+    std::unique_ptr<std::atomic<bool>[]> marked;
+    std::vector<uint32_t> queue;
+    std::vector<uint32_t> running;
+    std::mutex mutex;
+    std::condition_variable has_work;
+    size_t busy;
+    std::atomic<bool> failed;
+
+    size_t core, lemmas, checked, ignored;
+    std::string failure;
+};
+
+} // end namespace Satyricon
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef SATYRICON_IPASIR_H
+#define SATYRICON_IPASIR_H
+
+/**
+ * IPASIR: the standard C interface for incremental SAT solvers.
+ * A literal is a non zero integer, the negative value is the negated
+ * literal. The variables are created when they are used for the first time.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// name and version of the solver
+const char * ipasir_signature ();
+
+// create a new solver, and release it
+void * ipasir_init ();
+void ipasir_release (void * solver);
+
+// add a literal to the current clause, 0 terminates the clause
+void ipasir_add (void * solver, int lit_or_zero);
+
+// assume a literal for the next call of ipasir_solve only
+void ipasir_assume (void * solver, int lit);
+
+// solve the formula under the assumptions. Return 10 if satisfiable, 20 if
+// unsatisfiable and 0 if interrupted
+int ipasir_solve (void * solver);
+
+// after a satisfiable answer, the value of a literal: lit if true, -lit if
+// false
+int ipasir_val (void * solver, int lit);
+
+// after an unsatisfiable answer, 1 if the assumption lit was used to prove
+// the unsatisfiability, 0 otherwise
+int ipasir_failed (void * solver, int lit);
+
+// the search is interrupted when terminate(data) return a non zero value
+void ipasir_set_terminate (void * solver, void * data,
+        int (*terminate)(void * data));
+
+// learn(data, clause) is called for every learned clause with at most
+// max_length literals, the clause is terminated by 0
+void ipasir_set_learn (void * solver, void * data, int max_length,
+        void (*learn)(void * data, int * clause));
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef SATYRICON_METRICS_SERVER_HPP
+#define SATYRICON_METRICS_SERVER_HPP
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "solver_stats.hpp"
+
+namespace Satyricon {
+
+/**
+ * Local HTTP endpoint with the statistics of the solvers in the text format
+ * of Prometheus, for the monitoring of long searches. The solvers publish
+ * their statistics (usually from the progress callback), and a background
+ * thread answers every request with the last published ones, labelled by
+ * solver. The endpoint is a Unix socket or a port on localhost only.
+ */
+class Metrics_Server {
+public:
+    // the address is "unix:PATH" for a Unix socket, otherwise a port on
+    // 127.0.0.1. Throw a std::runtime_error if it can't listen
+    explicit Metrics_Server(const std::string &address);
+    ~Metrics_Server();
+
+    Metrics_Server(const Metrics_Server&) = delete;
+    Metrics_Server& operator=(const Metrics_Server&) = delete;
+
+    // the last statistics of a solver, safe from any thread
+    void publish(unsigned int solver, const SolverStats &s);
+
+    // the page served to a request
+    std::string metrics();
+
+private:
+    void serve_loop();
+    void answer(int client);
+
+    int listen_fd;
+    // written to wake up the server at the destruction
+    int wake_fd[2];
+    std::string socket_path;
+
+    std::mutex mutex;
+    std::map<unsigned int, SolverStats> latest;
+    std::thread server;
+};
+
+} // end namespace Satyricon
+
+#endif
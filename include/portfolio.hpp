@@ -0,0 +1,69 @@
+#ifndef SATYRICON_PORTFOLIO_HPP
+#define SATYRICON_PORTFOLIO_HPP
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include "clause_exchange.hpp"
+#include "sat_solver.hpp"
+
+namespace Satyricon {
+
+/**
+ * Portfolio of SAT solvers.
+ * The same problem is loaded in several SATSolver instances with different
+ * search parameters, and they run in parallel on separate threads. The
+ * first solver that find a definitive answer stops all the others.
+ */
+class PortfolioSolver {
+public:
+
+    explicit PortfolioSolver(unsigned int number_of_solvers);
+
+    // same interface of SATSolver for the problem construction, every
+    // clause is added to all the solvers
+    void set_number_of_variable(unsigned int n);
+    void reserve_clauses(unsigned int n);
+    bool add_clause(std::vector<Literal>& c);
+
+    // access a single solver, useful for the configuration
+    SATSolver& operator [] (size_t i) { return *solvers[i]; }
+    size_t size() const { return solvers.size(); }
+
+    // diversify the search parameter of all the solvers except the first.
+    // To be called after the configuration of the solvers
+    void diversify();
+
+    // enable or disable the exchange of learned clauses between the solvers
+    // (enabled by default)
+    void set_clause_sharing(bool s);
+
+    // run all the solvers in parallel, return true iff the problem is
+    // satisfiable
+    bool solve();
+
+    // number of clauses published on the exchange, and imported by solvers
+    uint64_t get_exchanged_clauses() const;
+    uint64_t get_imported_clauses() const;
+
+    // index of the solver that found the answer
+    size_t get_winner() const { return winner; }
+
+    // if the formula is satisfiable, return the model
+    const std::vector<int>& get_model();
+
+    // return a printable version of the model.
+    std::string string_model();
+
+private:
+    std::vector<std::unique_ptr<SATSolver> > solvers;
+    std::unique_ptr<Clause_Exchange> exchange;
+    std::vector<Literal> clause_copy;
+    std::atomic<bool> stop;
+    size_t winner;
+};
+
+} // end namespace Satyricon
+
+#endif
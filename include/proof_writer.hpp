@@ -0,0 +1,98 @@
+#ifndef SATYRICON_PROOF_WRITER_HPP
+#define SATYRICON_PROOF_WRITER_HPP
+
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "solver_types.hpp"
+
+namespace Satyricon {
+
+/**
+ * DRAT proof of an unsatisfiable formula, written in the binary or in the
+ * textual format. The solver fills a buffer, a full buffer is given to a
+ * background thread that write it to the file while the solver fills the
+ * other one, so the solver waits only if the disk is slower than the search.
+ * The proof is valid for a formula given before the first solve, the
+ * removed clauses added again by an incremental use can't be derived.
+ */
+class Proof_Writer {
+public:
+    // throw a std::runtime_error if the file can't be opened
+    Proof_Writer(const std::string &file_name, bool binary);
+    // write all the pending lemmas and close the file, ignoring the errors
+    ~Proof_Writer();
+
+    Proof_Writer(const Proof_Writer&) = delete;
+    Proof_Writer& operator=(const Proof_Writer&) = delete;
+
+    // a new lemma, or the deletion of a clause
+    template<typename Iterator>
+    void add(Iterator begin, Iterator end) { write('a', begin, end); }
+    template<typename Iterator>
+    void remove(Iterator begin, Iterator end) { write('d', begin, end); }
+
+    template<typename Container>
+    void add(const Container &c) { add(c.begin(), c.end()); }
+    template<typename Container>
+    void remove(const Container &c) { remove(c.begin(), c.end()); }
+
+    // write all the pending lemmas, and wait for the writer thread.
+    // throw a std::runtime_error if a write has failed
+    void flush();
+
+    // write all the pending lemmas and close the file, throw a
+    // std::runtime_error if a write or the close has failed
+    void close();
+
+    // number of lemmas and deletions written so far
+    uint64_t lemmas() const { return added; }
+    uint64_t deletions() const { return deleted; }
+
+private:
+    // a buffer is given to the writer when it is this big
+    static const size_t buffer_size = 1 << 20;
+
+    template<typename Iterator>
+    void write(char kind, Iterator begin, Iterator end) {
+        if ( kind == 'a' ) ++added; else ++deleted;
+        start_line(kind);
+        for ( ; begin != end; ++begin ) write_literal(*begin);
+        end_line();
+    }
+
+    void start_line(char kind);
+    void write_literal(Literal l);
+    void end_line();
+
+    // give the current buffer to the writer thread
+    void hand_over();
+    void writer_loop();
+    // wait for the writer thread to write all the lemmas
+    void drain();
+    // stop the writer thread and close the file
+    void stop();
+    void check_error() const;
+
+    std::FILE *file;
+    bool binary;
+    uint64_t added, deleted;
+
+    // filled by the solver, and written by the writer thread
+    std::vector<char> buffer;
+    std::vector<char> pending;
+
+    std::mutex mutex;
+    std::condition_variable has_pending, written;
+    bool closing;
+    // errno of the first failed write, nothing is written after it
+    int error;
+    std::thread writer;
+};
+
+} // end namespace Satyricon
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef SATYRICON_RESTART_POLICY_HPP
+#define SATYRICON_RESTART_POLICY_HPP
+
+#include <cstdint>
+#include <memory>
+
+namespace Satyricon {
+
+/**
+ * Available restart policies
+ */
+enum restart_mode {
+    RESTART_LUBY,    // luby sequence of conflicts
+    RESTART_GLUCOSE, // moving averages of the glue, with blocking
+    RESTART_STABLE   // alternate glucose (focused) and luby (stable) phases
+};
+
+/**
+ * Exponential moving average, with the bias correction for the first
+ * values (otherwise the average start from 0)
+ */
+class Moving_Average {
+public:
+    explicit Moving_Average(double a) : alpha(a), biased(0.0), beta(1.0) {}
+
+    void update(double x) {
+        biased += alpha * (x - biased);
+        beta *= 1.0 - alpha;
+    }
+
+    double value() const { return beta < 1.0 ? biased / (1.0 - beta) : 0.0; }
+
+private:
+    double alpha;
+    double biased;
+    double beta; // (1-alpha)^n
+};
+
+/**
+ * Restart policy of the search.
+ * The solver notify every conflict and every restart, and ask the policy if
+ * it is time to restart. The policies keep the count of the conflicts from
+ * the beginning of the search.
+ */
+class Restart_Policy {
+public:
+    virtual ~Restart_Policy() {}
+
+    // a conflict was analyzed, glue is the one of the learned clause and
+    // trail the number of assigned variables when the conflict was found
+    virtual void conflict(unsigned int glue, size_t trail) = 0;
+
+    // true if the search should restart now
+    virtual bool should_restart() = 0;
+
+    // the search is restarted
+    virtual void restart() = 0;
+
+    // in a stable phase the search is expected to be long and steady, so
+    // the decisions can follow the target phases
+    virtual bool stable() const = 0;
+
+    // name of the policy (or of its current phase), used in the log
+    virtual const char *name() const = 0;
+};
+
+// build a restart policy, the multiplier scale the luby sequence
+std::unique_ptr<Restart_Policy> make_restart_policy(restart_mode mode,
+        unsigned int luby_multiplier);
+
+// i-th element of the luby sequence (1,1,2,1,1,2,4,1,...), starting from 0
+unsigned int luby(unsigned int i);
+
+} // end namespace Satyricon
+
+#endif
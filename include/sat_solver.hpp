@@ -1,13 +1,32 @@
 #ifndef SATYRICON_SOLVER_HPP
 #define SATYRICON_SOLVER_HPP
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <functional>
 #include <vector>
 #include <memory>
 #include <unordered_map>
+#include "clause_exchange.hpp"
+#include "proof_writer.hpp"
+#include "restart_policy.hpp"
+#include "simplifier.hpp"
+#include "solver_stats.hpp"
 #include "solver_types.hpp"
 
 namespace Satyricon {
 
+/**
+ * Polarity of the decision literals
+ */
+enum polarity_mode {
+    POLARITY_SAVED, // the last value of the variable (phase saving)
+    POLARITY_POSITIVE,
+    POLARITY_NEGATIVE,
+    POLARITY_RANDOM
+};
+
 /**
  * parameter used during the research process
  */
@@ -19,14 +38,28 @@ struct SearchParameter {
         enable_deletion(true),
         enable_random_choice(true),
         enable_conflict_semplification(true),
+        enable_vivification(true),
+        restart_policy(RESTART_STABLE),
         restart_interval_multiplier(100),
-        restart_threshold(1),
         literal_decay_factor(1.0 / 0.95),
         literal_activity_update(1.0),
         clause_activity_update(1.0),
         clause_decay_factor(1.0 / 0.999),
         initial_learn_mult(0.5),
-        percentual_learn_increase(10.0)
+        percentual_learn_increase(10.0),
+        core_glue(2),
+        mid_glue(6),
+        garbage_fraction(0.20),
+        vivification_effort(0.1),
+        vivification_interval(2000),
+        preprocessing_threads(0),
+        polarity(POLARITY_SAVED),
+        enable_target_phase(true),
+        enable_rephase(true),
+        rephase_interval(1000),
+        share_max_size(8),
+        share_max_lbd(2),
+        share_export_rate(0.5)
     {}
 
     // enable or disable feature
@@ -35,10 +68,11 @@ struct SearchParameter {
     bool enable_deletion;
     bool enable_random_choice;
     bool enable_conflict_semplification;
+    bool enable_vivification;
 
-    // restartin policy
+    // restartin policy, the multiplier scale the luby sequence
+    restart_mode restart_policy;
     unsigned int restart_interval_multiplier;
-    unsigned int restart_threshold;
 
     // literal selection policy 
     double literal_decay_factor;
@@ -49,6 +83,42 @@ struct SearchParameter {
     double clause_decay_factor;
     double initial_learn_mult;
     double percentual_learn_increase;
+
+    // learned clauses with glue up to core_glue are never removed, and up to
+    // mid_glue are kept while they are used. The learn limit apply only to
+    // the others (local tier)
+    unsigned int core_glue;
+    unsigned int mid_glue;
+
+    // fraction of wasted memory in the clause arena that trigger a
+    // garbage collection
+    double garbage_fraction;
+
+    // the core and mid learned clauses are vivified at a restart, every
+    // vivification_interval conflicts. The propagations of a vivification
+    // are at most vivification_effort times the ones of the search
+    double vivification_effort;
+    unsigned int vivification_interval;
+
+    // threads used by the preprocessing of large formulas (0 means one for
+    // each core)
+    unsigned int preprocessing_threads;
+
+    // polarity of the decision literals
+    polarity_mode polarity;
+
+    // with saved phases, decide the phase of the longest conflict free
+    // assignment (target), and periodically reset the saved phases
+    bool enable_target_phase;
+    bool enable_rephase;
+    unsigned int rephase_interval;
+
+    // clause sharing policy: a learned clause is exported if it is short or
+    // if it has a small literal block distance. At most share_export_rate
+    // clauses are exported for each conflict
+    unsigned int share_max_size;
+    unsigned int share_max_lbd;
+    double share_export_rate;
 };
 
 /**
@@ -61,19 +131,58 @@ public:
     SATSolver();
     ~SATSolver();
 
-    // TODO: for minisat compatibility, and for problem creation as a library
-    //var newVar(); // get a new variable
-    
+    // Add a new variable to the problem, return its index
+    unsigned int new_variable();
+
     // Set the number of variable that can be used in the sat problem.
     // every possible variable is an atom that can be negated or not.
+    // The number can be increased between two calls of solve
     void set_number_of_variable(unsigned int n);
 
+    // Reserve memory for n clauses (usually from the DIMACS header)
+    void reserve_clauses(unsigned int n);
+
     // Add a new clause to the problem. The clause is a list of literal.
+    // It can be called between two calls of solve, the learned clauses
+    // remain valid. Return true if the formula become unsatisfiable
     bool add_clause(std::vector<Literal>& c);
 
     // Solve the problem instance, return true iff the problem is satisfiable
     bool solve();
 
+    // Solve the problem under assumptions: the assumed literals are the
+    // first decisions of the search. Return true iff the problem is
+    // satisfiable with all the assumptions true. The learned clauses are kept
+    // between calls, so the same solver can be used for many assumptions
+    bool solve(const std::vector<Literal> &assumptions);
+
+    // true if the formula is unsatisfiable regardless of the assumptions
+    bool proved_unsat() const;
+
+    // after an unsatisfiable answer under assumptions, the subset of the
+    // assumptions that are in conflict (empty if proved_unsat)
+    const std::vector<Literal>& get_failed_assumptions() const;
+
+    // the search is stopped when the callback return true, it is called
+    // after every conflict
+    void set_terminate( std::function<bool()> callback );
+
+    // the callback receives every learned clause with at most max_size
+    // literals
+    void set_learn( unsigned int max_size,
+            std::function<void(const std::vector<Literal>&)> callback );
+
+    // lookahead support. propagate_literal assign l on a new decision level
+    // and propagate it, return true if a conflict is found (the level is
+    // kept anyway, and must be removed with backtrack)
+    bool propagate_literal(Literal l);
+    void backtrack(unsigned int level);
+    unsigned int get_decision_level() const;
+    size_t get_assigned_variables() const;
+    literal_value get_value(Literal l) const;
+    double get_activity(var v) const;
+    unsigned int get_number_of_variable() const;
+
     // Set the logger
     void set_log( int level );
 
@@ -92,9 +201,15 @@ public:
     // enable or diable preprocessing of clauses
     void set_preprocessing(bool p);
 
+    // number of threads of the preprocessing, 0 for one for each core
+    void set_preprocessing_threads(unsigned int t);
+
     // enable or disable search restart
     void set_restart(bool p);
 
+    // enable or disable the vivification of the learned clauses
+    void set_vivification(bool v);
+
     // enable or disable deletion stratergy of learned clause
     void set_deletion(bool p);
 
@@ -105,7 +220,10 @@ public:
     // enable elimination of redundant literal in clauses generated by conflict.
     void set_conflict_clause_reduction( bool r );
 
-    // multiply the lenght of each restart sequence
+    // select the restart policy
+    void set_restart_policy(restart_mode m);
+
+    // multiply the lenght of each restart sequence (luby policy)
     void set_restarting_multiplier(unsigned int b);
 
     // define the starting maximum for learned clause.
@@ -116,28 +234,96 @@ public:
     // eliminated and the learn limit is increased by this factor
     void set_learning_increase( double value );
 
-private:
+    // select the polarity of the decision literals
+    void set_polarity( polarity_mode p );
+
+    // enable or disable the target phases and the periodic rephasing
+    void set_target_phase( bool t );
+    void set_rephase( bool r );
+
+    // initialize the random number generator from a seed
+    void set_random_seed( uint32_t seed );
+
+    // the search is stopped as soon as the flag become true (it is checked
+    // at every step, so it can be set from another thread)
+    void set_interrupt( const std::atomic<bool> *flag );
+
+    // true if the last call to solve was stopped by the interrupt flag, in
+    // that case the result of solve is meaningless
+    bool interrupted() const;
+
+    // share learned clauses with other solvers through an exchange, id must
+    // be unique among the solvers that use the same exchange
+    void set_clause_exchange( Clause_Exchange *e, unsigned int id );
+
+    // export filter and rate limit for the shared clauses
+    void set_sharing_limits( unsigned int max_size, unsigned int max_lbd );
+    void set_sharing_rate( double clauses_per_conflict );
+
+    // number of clauses exported to and imported from the exchange
+    uint64_t get_exported_clauses() const;
+    uint64_t get_imported_clauses() const;
+
+    // conflicts and propagated literals since the beginning (all the calls
+    // to solve)
+    uint64_t get_conflicts() const;
+    uint64_t get_propagations() const;
 
-    using ClausePtr = Clause*;
+    // counters, size of the database and memory of the solver. It must be
+    // called from the thread of the search, or between two calls to solve
+    SolverStats get_stats() const;
 
-    // strutcture for handle clauses in watch list, it can handle 2 literal
-    // clauses in a special way, directly embedding the other literal instead
-    // of a pointer to another clause (with a useless overhead)
+    // the callback receives the statistics during the search, at most once
+    // every interval seconds (at a restart or at a reduction of the learned
+    // clauses), on the thread of the search
+    void set_progress( double interval,
+            std::function<void(const SolverStats&)> callback );
+
+    // write a DRAT proof of unsatisfiability. Every learned, strengthened
+    // and removed clause is written, also by the preprocessing. The
+    // imported clauses can't be derived, so the solver must not share
+    void set_proof( Proof_Writer *p );
+
+private:
+
+    // strutcture for handle clauses in watch list. Binary clauses are not
+    // in the watch list, they are stored as implied literals in
+    // binary_watch_list
     struct Watcher {
-        // this struct is a tagged pointer, the real pointer alwas has 2 or 3
-        // zero as the LSB, so I use the first bit to identify if the clause
-        // is simply a literal
-        explicit Watcher(ClausePtr c) : clause(c){}
-        explicit Watcher(Literal l) : bits((l.index()<<1)+1){}
-
-        bool is_literal() { return bits & 1; }
-        Literal   get_literal() { return Literal::from_index( bits>>1 ); }
-        ClausePtr get_clause()  { return clause; }
+        // every watcher carry a blocker, a literal of the clause different
+        // from the watched one. If the blocker is true the clause is
+        // satisfied, and it is possible to skip it without reading the clause
+        Watcher(CRef c, Literal b) : clause(c), blocker(b) {}
+
+        CRef clause;
+        Literal blocker;
+    };
+
+    // reason of an implied literal. It is a clause reference or, for a
+    // binary clause, directly the other (false) literal of the clause.
+    // the MSB is used to identify a literal (a CRef is always < 2^31)
+    struct Antecedent {
+        Antecedent() : ref(CREF_UNDEF) {}
+        explicit Antecedent(CRef c) : ref(c) {}
+        explicit Antecedent(Literal l) : ref(l.index() | BINARY_TAG) {}
+
+        bool is_undef()  const { return ref == CREF_UNDEF; }
+        bool is_clause() const { return !(ref & BINARY_TAG); }
+        bool is_binary() const { return !is_undef() && !is_clause(); }
+        Literal get_literal() const {
+            return Literal::from_index(ref & ~BINARY_TAG);
+        }
+
+        bool operator==(const Antecedent& o) const { return ref == o.ref; }
+        bool operator!=(const Antecedent& o) const { return ref != o.ref; }
+
+        CRef ref;
     private:
-        union {ClausePtr clause; uint64_t bits;};
+        static const uint32_t BINARY_TAG = 1u << 31;
     };
 
     using WatchMap = std::vector<std::vector<Watcher> >;
+    using BinaryWatchMap = std::vector<std::vector<Literal> >;
 
     // print the search status
     void print_status(unsigned int conflict, unsigned int restart,
@@ -148,70 +334,174 @@ private:
 
     // learn the conflict clause
     //bool learn_clause();
-    void learn_clause(std::vector<Literal> & lits);
+    void learn_clause(std::vector<Literal> & lits, unsigned int glue);
+
+    bool new_clause(std::vector<Literal> & lits, bool learnt, CRef &c_ref);
+
+    // add a binary clause (a or b) to the binary watch lists
+    void attach_binary(Literal a, Literal b);
+
+    // literal block distance: number of different decision levels in a
+    // clause with all literals assigned
+    unsigned int compute_lbd(const std::vector<Literal> &lits);
 
-    bool new_clause(std::vector<Literal> & lits, bool learnt, ClausePtr &c_ref);
+    // glue of a clause used in the conflict analysis, the implied literal
+    // is already unassigned but it is always at the current level
+    unsigned int clause_glue(const Clause &c);
 
-    void remove_from_vect( std::vector<ClausePtr> &v, ClausePtr c );
-    void remove_from_vect( std::vector<Watcher> &v, ClausePtr c );
+    // tier of a new learned clause
+    clause_tier glue_tier(unsigned int glue) const;
 
-    void remove_clause( ClausePtr c );
+    // clause sharing. import_shared_clauses return true if an imported
+    // clause is in conflict at level 0
+    void export_clause(const std::vector<Literal> &lits, unsigned int glue);
+    bool import_shared_clauses();
+    bool import_clause(std::vector<Literal> &lits);
+
+    void remove_from_vect( std::vector<Watcher> &v, CRef c );
 
     // get value of a literal
     literal_value get_asigned_value(const Literal & l) const;
 
-    // assign a literal l with antecedent c (nullptr for decided)
-    bool assign(Literal l, ClausePtr c);
+    // assign a literal l with antecedent c (undefined for decided)
+    bool assign(Literal l, Antecedent c);
 
-    // propage the effect of the previous assignment
-    ClausePtr propagation();
+    // propage the effect of the previous assignment, the binary clauses are
+    // propagated before the others. If a conflict is found, return its
+    // antecedent (for a binary conflict the literals are in binary_conflict)
+    Antecedent propagation();
 
     // analyze a conflict clause and create a new clause to be learned
     // and a proper backtrack level
     int conflict_analysis();
-    void conflict_analysis(ClausePtr conflict,
+    void conflict_analysis(Antecedent conflict,
             std::vector<Literal> &out_learnt, int &out_btlevel);
 
-    // Preprocess the set of clause
-    void preprocessing();
-
-    // interval before restart
-    unsigned int next_restart_interval( unsigned int pos);
-    unsigned int new_restart_threshold();
+    // conflict clause minimization: true if the false literal p is implied
+    // by the other literals of the learned clause. abstract_levels is the
+    // set of decision levels of the clause (one bit for each level mod 32)
+    bool literal_redundant(Literal p, uint32_t abstract_levels);
+    uint32_t abstract_level(var v) const {
+        return 1u << (decision_levels[v] & 31);
+    }
+
+    // i-th literal of the antecedent of v, excluding v itself
+    Literal reason_literal(var v, size_t i) const;
+    size_t reason_size(var v) const;
+
+    // find the assumptions responsible for the assumption p to be false
+    void analyze_final(Literal p);
+
+    // Preprocess the set of clause, before the first search. The variables
+    // of the assumptions are not eliminated. Return true if a conflict is
+    // found
+    bool preprocessing(const std::vector<Literal> &assumptions);
+
+    // failed literal probing at level 0: every candidate literal is assumed
+    // and propagated. If a conflict is found its negation is a unit,
+    // otherwise a literal r implied by a long clause give the binary clause
+    // (!d r), with d the dominator of the false literals of the clause
+    // (hyper binary resolution). Return true if a conflict is found
+    bool probe();
+
+    // an eliminated variable is used again (in a new clause or in an
+    // assumption): all the removed clauses are added back to the formula.
+    // Return true if a conflict is found
+    bool restore_eliminated();
 
     Literal choice_lit();
 
+    // record the phases of the conflict free part of the trail, before the
+    // analysis of a conflict
+    void update_target_phase();
+
+    // reset the saved phases, rotating between the original, inverted,
+    // best, random and target phases
+    void rephase();
+
     // decide a literal
     bool assume( Literal p );
 
-    // reduce learned clause. The clauses are sorted by activity,
-    // and the lower half are removed execept of clauses that are the
-    // antecedent of an assigned literal.
+    // vivification of the learned clauses in the core and mid tiers not yet
+    // vivified, at level 0. The negations of the literals of a clause are
+    // assumed one at a time: a literal implied false is removed, and a
+    // conflict or a literal implied true make the remaining literals useless.
+    // At most budget literals are propagated. Return true if a conflict is
+    // found
+    bool vivify(uint64_t budget);
+
+    // reduce learned clause. The core tier is never touched, the mid tier
+    // clauses not used since the last reduction are moved to the local tier.
+    // Half of the local clauses are removed by activity, execept of clauses
+    // that are used or that are the antecedent of an assigned literal.
     void reduce_learned();
 
-    void simplify(std::vector<ClausePtr> &vect);
-    bool simplify_clause( ClausePtr c );
+    // simplification at level 0, when new literals are assigned at level 0
+    // since the last one: the satisfied clauses are removed, and the false
+    // literals are removed from the others (a clause reduced to two
+    // literals is moved in the binary implication lists). The removed
+    // clauses are only marked as deleted, and the watch lists are swept
+    // once at the end
+    void simplify_database();
+    void simplify(std::vector<CRef> &vect);
+    // return true if the clause must be removed
+    bool simplify_clause( CRef c );
+
+    // remove the watchers of the deleted clauses from all the watch lists
+    void sweep_watch_lists();
 
 
+    // if enough memory is wasted in the clause arena, compact it
+    void check_garbage();
+    void garbage_collect();
+    void relocate_all(Clause_Allocator &to);
+
     // decay the activity of clause. This is an O(1) operation
     void clause_activity_decay();
-    void literals_activity_decay();
+    void variables_activity_decay();
 
     // clause collections
-    std::vector<ClausePtr > clauses;
-    std::vector<ClausePtr > learned;
+    Clause_Allocator ca;
+    std::vector<CRef > clauses;
+    std::vector<CRef > learned;
+    size_t local_learned; // learned clauses in the local tier
     unsigned int number_of_variable;
+    unsigned int number_of_binary_clauses;
+
+    // variables removed by the preprocessing, and the clauses required to
+    // compute their value in the model
+    bool preprocessed;
+    std::vector<bool> eliminated;
+    // limits of the probing, for each clause of the formula: literals
+    // propagated and binary clauses added
+    static const unsigned int probing_effort = 20;
+    static constexpr double probing_binaries = 0.5;
+    size_t number_of_eliminated;
+    Extension_Stack extension;
 
     // watch list, used for propagation
     WatchMap watch_list;
+    BinaryWatchMap binary_watch_list;
 
     // assigned values
     std::vector<literal_value> values;
     std::vector<int> decision_levels;
-    std::vector<ClausePtr > antecedents;
+    std::vector<Antecedent> antecedents;
 
-    // keep track of the variable to propagate in the trail
+    // keep track of the variable to propagate in the trail (the binary
+    // clauses are propagated ahead of the others)
     std::vector<Literal>::size_type propagation_starting_pos;
+    std::vector<Literal>::size_type binary_propagation_pos;
+    // counters of the search, and the periodic report of them
+    SolverStats stats;
+    std::function<void(const SolverStats&)> progress_callback;
+    std::chrono::duration<double> progress_interval;
+    std::chrono::steady_clock::time_point last_progress;
+    void report_progress();
+    // level 0 literals and propagations at the last simplification, the
+    // next one require new literals and enough propagations
+    size_t simplified_assigned;
+    uint64_t next_simplify;
 
     // trail of assignment
     std::vector<Literal> trail;
@@ -237,20 +527,81 @@ private:
     // if the clause is sat, this vector contein a model for the solution
     std::vector<int> model;
 
-    // values for luby sequence, used for restart policy
-    unsigned int luby_next = 0;
+    // restart policy of the current search
+    std::unique_ptr<Restart_Policy> restarts;
 
     // support data structure
     std::vector<Literal> solve_conflict_literals;
     std::vector<Watcher> propagation_to_move;
-    std::vector<bool> analisys_seen;
-    std::vector<Literal> analisys_reason;
-
-    std::vector<double> literals_activity;
-    Literal_Order order;
+    std::array<Literal,2> binary_conflict;
+
+    // state of a variable during the conflict analysis. The minimization
+    // remember the literals found removable or not, so every literal is
+    // explored once for each conflict
+    enum seen_state : uint8_t {
+        SEEN_UNDEF = 0,
+        SEEN_SOURCE,    // in the learned clause (or in the conflict level)
+        SEEN_REMOVABLE, // implied by the literals of the learned clause
+        SEEN_FAILED     // not implied by the literals of the learned clause
+    };
+    struct Minimization_Frame {
+        size_t i;  // next literal of the antecedent of l
+        Literal l;
+    };
+    std::vector<uint8_t> analisys_seen;
+    // variables with a seen state to reset at the end of the analysis
+    std::vector<Literal> analisys_clear;
+    std::vector<Minimization_Frame> analisys_stack;
+
+    std::vector<double> variables_activity;
+    Variable_Order order;
+
+    // last value of every variable, saved when it is unassigned
+    std::vector<bool> saved_phase;
+    std::vector<int> occurrence_balance;
+
+    // phases of the longest conflict free trail since the last rephase
+    // (target), and since the last best rephase (best)
+    std::vector<bool> target_phase;
+    std::vector<bool> best_phase;
+    size_t target_assigned;
+    size_t best_assigned;
+    unsigned int rephase_count;
     
     uint32_t seed_1, seed_2, seed_3, seed_4;
 
+    // cooperative interruption of the search
+    const std::atomic<bool> *interrupt_flag;
+    bool search_interrupted;
+
+    // a conflict at level 0 was found, no assumption can help
+    bool root_conflict;
+    // the empty clause end the proof
+    void set_root_conflict();
+    std::vector<Literal> failed_assumptions;
+
+    // callbacks for the incremental use
+    std::function<bool()> terminate_callback;
+    std::function<void(const std::vector<Literal>&)> learn_callback;
+    unsigned int learn_callback_size;
+
+    // clause sharing
+    Clause_Exchange *exchange;
+    unsigned int exchange_id;
+    uint64_t exchange_cursor;
+    double export_budget;
+    uint64_t exported_clauses, imported_clauses;
+    std::vector<unsigned int> lbd_seen;
+    unsigned int lbd_stamp;
+
+    // proof of unsatisfiability, and a copy of a clause changed in place
+    Proof_Writer *proof;
+    std::vector<Literal> proof_clause;
+    // the level 0 literals are written as units before the clauses that
+    // imply them are removed, the first proof_units are already written
+    size_t proof_units;
+    void write_proof_units();
+
     SearchParameter param;
 };
 
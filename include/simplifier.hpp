@@ -0,0 +1,181 @@
+#ifndef SATYRICON_SIMPLIFIER_HPP
+#define SATYRICON_SIMPLIFIER_HPP
+
+#include <cstdint>
+#include <vector>
+#include "proof_writer.hpp"
+#include "solver_types.hpp"
+
+namespace Satyricon {
+
+/**
+ * Clauses removed from the formula by the simplification, used to extend a
+ * model of the simplified formula to a model of the original one.
+ * Every clause has a witness literal: going backward from the last clause,
+ * when a clause is not satisfied by the model its witness is set to true.
+ */
+class Extension_Stack {
+public:
+    Extension_Stack() : literals(), sizes() {}
+
+    // the witness must be a literal of the clause
+    void push(Literal witness, const std::vector<Literal> &clause);
+
+    // extend the assignment, the unassigned variables are considered false
+    void extend(std::vector<literal_value> &values) const;
+
+    bool empty() const { return sizes.empty(); }
+    void clear() { literals.clear(); sizes.clear(); }
+    size_t bytes() const {
+        return literals.capacity() * sizeof(Literal) +
+            sizes.capacity() * sizeof(size_t);
+    }
+
+    // call f for every clause in the stack
+    template<typename Function>
+    void for_each_clause(Function f) const {
+        std::vector<Literal> clause;
+        size_t begin = 0;
+        for ( size_t s : sizes ) {
+            clause.assign(literals.begin() + begin,
+                    literals.begin() + begin + s);
+            f(clause);
+            begin += s;
+        }
+    }
+
+private:
+    // all the clauses one after the other, each one with the witness first
+    std::vector<Literal> literals;
+    std::vector<size_t> sizes;
+};
+
+/**
+ * Simplification of a formula before the search.
+ * The clauses are copied from the solver and kept with occurrence lists, the
+ * simplified formula is then given back to the solver. The equivalent
+ * literals (strongly connected components of the binary implication graph)
+ * are replaced by a representative. The duplicate and subsumed clauses are
+ * removed, and the clauses are strengthened by self subsuming resolution.
+ * Bounded variable elimination (as in SatELite) replace all the clauses of
+ * a variable with their resolvents, when this doesn't increase the number
+ * of clauses.
+ * The frozen variables are never eliminated or substituted.
+ * With a proof, every new clause is written before the clauses it replace
+ * are removed.
+ */
+class Clause_Simplifier {
+public:
+    explicit Clause_Simplifier(unsigned int number_of_variable);
+
+    void add_clause(const std::vector<Literal> &c);
+    void freeze(var v);
+    void set_proof(Proof_Writer *p) { proof = p; }
+
+    // replace the literals of every strongly connected component of the
+    // binary implication graph with a single representative, the
+    // equivalences are pushed in the extension stack. Return false if the
+    // formula is unsatisfiable (l and !l are equivalent)
+    bool substitute(Extension_Stack &extension);
+
+    // remove the duplicate and subsumed clauses, and remove a literal l
+    // from a clause D when (D - l + !l) is subsumed. For large formulas the
+    // candidates are searched by many threads. Return false if the formula
+    // is unsatisfiable
+    bool subsume(unsigned int threads);
+
+    // bounded variable elimination, the removed clauses are pushed in the
+    // extension stack. Return false if the formula is unsatisfiable
+    bool eliminate(Extension_Stack &extension);
+
+    // true if the variable is eliminated or substituted
+    bool is_eliminated(var v) const { return eliminated[v]; }
+    size_t eliminated_variables() const { return number_of_eliminated; }
+    size_t substituted_variables() const { return number_of_substituted; }
+    size_t subsumed_clauses() const { return number_of_subsumed; }
+    size_t strengthened_clauses() const { return number_of_strengthened; }
+
+    // number of clauses in the simplified formula
+    size_t size() const { return number_of_clauses; }
+
+    // call f for every clause of the simplified formula
+    template<typename Function>
+    void for_each_clause(Function f) const {
+        for ( size_t i = 0; i < clauses.size(); ++i )
+            if ( ! removed[i] ) f(clauses[i]);
+    }
+
+private:
+    // limits of the elimination: a variable with too many occurrences of
+    // one of its literals is not considered, a resolvent can't be too long,
+    // and the total work (literals visited) is bounded
+    static const size_t occurrence_limit = 1000;
+    static const size_t resolvent_limit = 20;
+    static const uint64_t step_limit = 100000000;
+    // minimum number of clauses for a parallel subsumption
+    static const size_t parallel_threshold = 100000;
+
+    // c can subsume or strengthen d
+    struct Subsumption_Candidate {
+        size_t c, d;
+    };
+
+    // a bit for each variable (modulo 64) of the clause, if the bits of c
+    // are not in d then c can't subsume d
+    static uint64_t signature(const std::vector<Literal> &c);
+
+    // true if c subsume d (flipped is undefined) or if c strengthen d
+    // (flipped is the literal to remove from d). The clauses are sorted
+    bool subsumes(size_t c, size_t d, Literal &flipped) const;
+
+    // search the clauses subsumed or strengthened by sources[begin,end),
+    // it doesn't change the formula and can run on many threads
+    void find_candidates(const std::vector<size_t> &sources, size_t begin,
+            size_t end, std::vector<Subsumption_Candidate> &out) const;
+
+    void remove_clause(size_t c);
+
+    // the occurrences of l, without the removed clauses
+    std::vector<size_t> &occurrences_of(Literal l);
+
+    // resolve the clauses c and d on the variable v, return false if the
+    // resolvent is a tautology
+    bool resolve(size_t c, size_t d, var v, std::vector<Literal> &resolvent);
+
+    // return false if the formula is unsatisfiable
+    bool try_eliminate(var v, Extension_Stack &extension);
+
+    // the variable v is in a changed clause, it is a new candidate
+    void touch(var v);
+
+    std::vector<std::vector<Literal> > clauses;
+    std::vector<bool> removed;
+    std::vector<uint64_t> signatures;
+    size_t number_of_clauses;
+    size_t number_of_subsumed, number_of_strengthened;
+
+    // clauses of every literal (indexed by literal index)
+    std::vector<std::vector<size_t> > occurrences;
+
+    std::vector<bool> frozen;
+    std::vector<bool> eliminated;
+    size_t number_of_eliminated;
+    size_t number_of_substituted;
+
+    // candidates for the next round of elimination
+    std::vector<var> touched;
+    std::vector<bool> is_touched;
+
+    // literals of a clause, marked with a stamp to avoid the clear
+    std::vector<uint32_t> marks;
+    uint32_t stamp;
+
+    std::vector<std::vector<Literal> > resolvents;
+    uint64_t steps;
+
+    Proof_Writer *proof;
+};
+
+} // end namespace Satyricon
+
+#endif
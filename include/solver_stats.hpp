@@ -0,0 +1,76 @@
+#ifndef SATYRICON_SOLVER_STATS_HPP
+#define SATYRICON_SOLVER_STATS_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Satyricon {
+
+/**
+ * Counters of a solver since its creation, the size of its clause database
+ * and its memory (in bytes) by component. The counters are updated by the
+ * search, the sizes and the memory are computed by SATSolver::get_stats.
+ */
+struct SolverStats {
+    SolverStats() :
+        decisions(0), propagations(0), conflicts(0), restarts(0),
+        reductions(0), reduced_clauses(0), uip_literals(0),
+        learned_literals(0), watch_visits(0), binary_visits(0),
+        variables(0), clauses(0), binary_clauses(0), learned(0),
+        clause_bytes(0), watch_bytes(0), binary_watch_bytes(0),
+        variable_bytes(0), extension_bytes(0)
+    {}
+
+    // search
+    uint64_t decisions;
+    uint64_t propagations;
+    uint64_t conflicts;
+    uint64_t restarts;
+
+    // reductions of the learned clauses, and the clauses removed by them
+    uint64_t reductions;
+    uint64_t reduced_clauses;
+
+    // literals of the learned clauses, before the minimization (first UIP)
+    // and after it
+    uint64_t uip_literals;
+    uint64_t learned_literals;
+
+    // watchers and binary implications in the lists of the propagated
+    // literals
+    uint64_t watch_visits;
+    uint64_t binary_visits;
+
+    // current database
+    uint64_t variables;
+    uint64_t clauses;
+    uint64_t binary_clauses;
+    uint64_t learned;
+
+    // memory: clause arena and references, watch lists, binary implication
+    // lists, assignment and heuristics of the variables, eliminated clauses
+    uint64_t clause_bytes;
+    uint64_t watch_bytes;
+    uint64_t binary_watch_bytes;
+    uint64_t variable_bytes;
+    uint64_t extension_bytes;
+};
+
+// description of a field, for the exporters
+struct Stats_Field {
+    const char *name;
+    const char *help;
+    bool counter; // a counter only increase, the others are gauges
+    uint64_t SolverStats::*value;
+};
+
+// all the fields, in the order of the declaration
+const std::vector<Stats_Field>& stats_fields();
+
+// a JSON object with a member for each field, in a single line
+std::string to_json(const SolverStats &s);
+
+} // end namespace Satyricon
+
+#endif
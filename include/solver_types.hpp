@@ -2,12 +2,15 @@
 #define SATYRICON_SOLVER_TYPES_HPP
 
 #include <assert.h>
+#include <algorithm>
+#include <cstdint>
 #include <iostream>
 #include <memory>
 #include <new>
 #include <vector>
 #include <set>
 #include <sstream>
+#include <stdexcept>
 #include <string>
 #include <stdlib.h>
 
@@ -24,6 +27,15 @@ enum literal_value {
     LIT_TRUE = 2
 };
 
+/**
+ * Tier of a learned clause, it decide how long the clause is kept
+ */
+enum clause_tier {
+    TIER_CORE,  // very low glue, never removed
+    TIER_MID,   // low glue, kept while it is used in the conflicts
+    TIER_LOCAL  // removed by activity
+};
+
 /**
  * Literal class.
  * Contain the basic information required to rappresent a literal and
@@ -83,56 +95,101 @@ inline std::ostream& operator<<(std::ostream &os, std::vector<Literal> const &v)
     return os << "}";
 }
 
+// reference to a clause inside a Clause_Allocator, it is an offset (in 32 bit
+// words) from the beginning of the arena
+typedef uint32_t CRef;
+static const CRef CREF_UNDEF = UINT32_MAX; // undefined clause reference
+
 /**
  * Clause class
  * this class rappresent a clause of at list two literals
- * the clause is intended to be bound to a specific instance of a Solver
+ * the clause is intended to be bound to a specific instance of a Solver, and
+ * it live inside the arena of a Clause_Allocator. The memory layout is a 32
+ * bit header, followed by the activity (only for learned clauses) and by the
+ * literals.
  */
 class Clause final {
 using Iterator = Literal *;
 using ConstIterator = const Literal *;
 
 private:
-    bool learned  :  1;
-    uint64_t _size : 31;
-
-    // not to be used directly, but only with allocate function
-    Clause(bool l,const std::vector<Literal> &lits) :
-        learned(l), _size(lits.size()) {
-            std::copy(lits.begin(),lits.end(),this->begin());
-            if ( learned ) get_activity() = 1.0;
+    unsigned int learned   :  1;
+    unsigned int relocated :  1;
+    unsigned int deleted   :  1;
+    unsigned int _size     : 29;
+
+    // a learned clause have two more words after the header: the activity
+    // and the glue (literal block distance) with the information for the
+    // reduction of the learned clauses
+    struct Learned_Header {
+        unsigned int glue     : 28;
+        unsigned int tier     :  2;
+        unsigned int used     :  1; // used in a conflict since the last reduction
+        unsigned int vivified :  1; // already vivified once
+    };
+
+    Learned_Header &get_learned_header() {
+        assert(is_learned());
+        return *reinterpret_cast<Learned_Header*>(
+                reinterpret_cast<uint32_t*>(this+1) + 1);
+    }
+    const Learned_Header &get_learned_header() const {
+        assert(is_learned());
+        return *reinterpret_cast<const Learned_Header*>(
+                reinterpret_cast<const uint32_t*>(this+1) + 1);
+    }
+
+    // not to be used directly, but only with Clause_Allocator
+    Clause(bool l, const Literal *lits, size_t n) :
+        learned(l), relocated(0), deleted(0), _size(n) {
+            if ( learned ) {
+                get_activity() = 1.0;
+                get_learned_header() = Learned_Header{
+                    static_cast<unsigned int>(n), TIER_LOCAL, 0, 0 };
+            }
+            std::copy(lits,lits+n,this->begin());
         }
 
+    friend class Clause_Allocator;
+
 public:
-    static Clause* allocate(const std::vector<Literal> &lits,
-            bool learnt = false) {
-
-        auto size = sizeof(Clause) + sizeof(Literal)*lits.size();
-        if ( learnt ) size += sizeof(double);
-        void* memory =  malloc(size);
-        assert( memory != nullptr);
-        return new (memory) Clause(learnt,lits);
-    }
+    Clause(const Clause& other) = delete;
+    Clause& operator=(const Clause& other) = delete;
 
-    static void deallocate(Clause* &c) {
-        assert( c != nullptr);
-        c->~Clause();
-        free((void*)c);
-        c = nullptr;
+    // number of 32 bit words used by a clause
+    static size_t words(size_t size, bool learnt) {
+        return 1 + (learnt ? 2 : 0) + size;
     }
-    
-    uint64_t size() const { return _size; }
+
+    uint32_t size() const { return _size; }
     bool is_learned() const { return learned; }
-    double &get_activity() {
+    float &get_activity() {
+        assert(is_learned());
+        return *reinterpret_cast<float*>(this+1);
+    }
+    float get_activity() const {
         assert(is_learned());
-        return *reinterpret_cast<double*>(end());
+        return *reinterpret_cast<const float*>(this+1);
     }
 
+    unsigned int get_glue() const { return get_learned_header().glue; }
+    void set_glue(unsigned int g) { get_learned_header().glue = g; }
+    clause_tier get_tier() const {
+        return static_cast<clause_tier>(get_learned_header().tier);
+    }
+    void set_tier(clause_tier t) { get_learned_header().tier = t; }
+    bool is_used() const { return get_learned_header().used; }
+    void set_used(bool u) { get_learned_header().used = u; }
+    bool is_vivified() const { return get_learned_header().vivified; }
+    void set_vivified(bool v) { get_learned_header().vivified = v; }
+
     Literal* get_data() {
-        return reinterpret_cast<Literal*>(this+1);
+        return reinterpret_cast<Literal*>(
+                reinterpret_cast<uint32_t*>(this+1) + 2*learned);
     }
     const Literal* get_data() const {
-        return reinterpret_cast<const Literal*>(this+1);
+        return reinterpret_cast<const Literal*>(
+                reinterpret_cast<const uint32_t*>(this+1) + 2*learned);
     }
 
     Iterator begin() { return get_data(); }
@@ -165,143 +222,253 @@ public:
         if ( new_size == _size ) return;
         _size = new_size;
     }
+
+    // a freed clause is only marked, its watchers are removed later
+    bool is_deleted() const { return deleted; }
+
+    // after a relocation, the first word after the header contain the
+    // reference of the new copy of the clause
+    bool is_relocated() const { return relocated; }
+    CRef relocation() const { return *reinterpret_cast<const CRef*>(this+1); }
+    void relocate(CRef c) {
+        relocated = 1;
+        *reinterpret_cast<CRef*>(this+1) = c;
+    }
 };
 
+static_assert(sizeof(Clause) == sizeof(uint32_t), "clause header is one word");
+
 /**
- * Binary heap class, based on the CLR description
+ * Region based allocator for clauses.
+ * All the clauses are stored in a contiguous arena and they are identified by
+ * their offset (CRef). The freed memory is only counted, it is reclaimed by
+ * relocating all the live clauses inside a new allocator.
  */
-class Literal_Heap {
-    using size_type = size_t;
+class Clause_Allocator {
 public:
-    explicit Literal_Heap(const std::vector<double> &v):
-        activity(v), value(), map_position()  {}
-
-    Literal pop_max() {
-        assert(!value.empty());
-
-        auto max = value.front();
-        value.front() = value.back();
-        map_position[max.index()] = -1;
-        map_position[value.front().index()] = 0;
-        value.pop_back();
-        heapify(0);
-        return max;
+    Clause_Allocator() : memory(), wasted_words(0) {}
+
+    CRef allocate(const std::vector<Literal> &lits, bool learnt = false) {
+        return allocate(lits.data(), lits.size(), learnt);
     }
 
-    void insert(const Literal& val) {
-        if ( map_position[val.index()] != -1 ) return; // already inserted
+    CRef allocate(const Literal *lits, size_t n, bool learnt) {
+        size_t ref = memory.size();
+        // the solver use the MSB of a reference as a tag, the arena can't
+        // grow over 2^31 words, and the size of a clause has 29 bits
+        // (checked also in the release build)
+        if ( n >= (1u << 29) || ref + Clause::words(n,learnt) >= (1u << 31) )
+            throw std::length_error("clause arena over 2^31 words");
+        memory.resize( ref + Clause::words(n,learnt) );
+        new (&memory[ref]) Clause(learnt,lits,n);
+        return static_cast<CRef>(ref);
+    }
 
-        value.push_back(val);
-        map_position[val.index()] = static_cast<int>(value.size()-1);
-        increase_key(value.size()-1);
+    // the memory is not released, it is only marked as wasted and the
+    // clause is marked as deleted
+    void free(CRef c) {
+        Clause &cl = (*this)[c];
+        cl.deleted = 1;
+        wasted_words += Clause::words(cl.size(),cl.is_learned());
     }
 
-    void update(const Literal& val) {
-        if ( map_position[val.index()] != -1 )
-            increase_key(static_cast<unsigned int>(map_position[val.index()]));
+    // shrink a clause, the removed literals are marked as wasted
+    void shrink(CRef c, size_t new_size) {
+        wasted_words += (*this)[c].size() - new_size;
+        (*this)[c].shrink(new_size);
     }
 
-    void set_size( unsigned int s ) {
-        map_position.resize(s,-1);
+    // move a clause inside another allocator, and update the reference
+    void relocate(CRef &c, Clause_Allocator &to) {
+        Clause &cl = (*this)[c];
+        if ( ! cl.is_relocated() ) {
+            CRef n = to.allocate(cl.begin(), cl.size(), cl.is_learned());
+            if ( cl.is_learned() ) {
+                to[n].get_activity() = cl.get_activity();
+                to[n].get_learned_header() = cl.get_learned_header();
+            }
+            cl.relocate(n);
+        }
+        c = cl.relocation();
     }
 
-    void initialize() {
-        value.clear();
-        value.reserve(map_position.size());
+    void reserve(size_t words) { memory.reserve(words); }
 
-        for ( int i = 0; i < static_cast<int>(map_position.size()/2); ++i ) {
+    size_t size() const { return memory.size(); }
+    size_t bytes() const { return memory.capacity() * sizeof(uint32_t); }
+    size_t wasted() const { return wasted_words; }
 
-            Literal l(i,false);
-            value.push_back(l);
-            map_position[l.index()] = value.size()-1;
+    Clause& operator [] (CRef c) {
+        return *reinterpret_cast<Clause*>(&memory[c]);
+    }
+    const Clause& operator [] (CRef c) const {
+        return *reinterpret_cast<const Clause*>(&memory[c]);
+    }
 
-            l = Literal(i,true);
-            value.push_back(l);
-            map_position[l.index()] = value.size()-1;
+private:
+    std::vector<uint32_t> memory;
+    size_t wasted_words;
+};
 
+/**
+ * 4-ary max heap of variables, ordered by activity.
+ * The children of a node are contiguous in memory, and the tree is half as
+ * deep as a binary heap, so the sift operations touch less cache lines.
+ * The activity is read from an external vector, indexed by variable.
+ */
+class Variable_Heap {
+    using size_type = size_t;
+public:
+    explicit Variable_Heap(const std::vector<double> &v):
+        activity(v), heap(), position()  {}
+
+    bool empty() const { return heap.empty(); }
+    bool contains(var v) const { return position[v] != -1; }
+
+    var pop_max() {
+        assert(!heap.empty());
+
+        var max = heap.front();
+        var last = heap.back();
+        heap.pop_back();
+        position[max] = -1;
+        if ( ! heap.empty() ) {
+            heap.front() = last;
+            position[last] = 0;
+            sift_down(0);
         }
-        assert( value.size() == map_position.size());
+        return max;
+    }
 
-        for ( int i = value.size()/2; i >= 0; --i )
-            heapify(i);
+    void insert(var v) {
+        if ( contains(v) ) return; // already inserted
 
+        heap.push_back(v);
+        position[v] = static_cast<int>(heap.size()-1);
+        sift_up(heap.size()-1);
     }
 
+    // the activity of v is increased
+    void update(var v) {
+        if ( contains(v) )
+            sift_up(static_cast<size_type>(position[v]));
+    }
+
+    void set_size( unsigned int s ) {
+        position.resize(s,-1);
+    }
+
+    // build the heap from a set of variables, in linear time
+    void build(const std::vector<var> &vars) {
+        for ( auto v : heap ) position[v] = -1;
+        heap = vars;
+        for ( size_type i = 0; i < heap.size(); ++i )
+            position[heap[i]] = static_cast<int>(i);
+        for ( size_type i = heap.size()/4 + 1; i-- > 0; )
+            sift_down(i);
+    }
 
 private:
 
     const std::vector<double> &activity;
-    std::vector<Literal> value;
-    std::vector<int> map_position;
-
-    // tree navigation (0 based, it's different from CLR's 1 based)
-    size_type father(size_type i) { return (i-1) >> 1; }
-    size_type left(size_type i)   { return (i<<1) + 1; }
-    size_type right(size_type i)  { return (i+1) << 1; }
-
-    void heapify(size_type i) {
-        //std::cout <<"heapify " << i << " " << left(i) << " " << right(i) << std::endl;
-        auto largest = i;
-        if (left(i) < value.size()  && activity[value[largest].index()] < activity[value[left(i)].index()] )
-            largest = left(i);
-        if (right(i) < value.size()  && activity[value[largest].index()] < activity[value[right(i)].index()] )
-            largest = right(i);
-
-        if ( largest != i ) {
-            std::swap(value[i],value[largest]);
-            std::swap(map_position[value[i].index()],
-                    map_position[value[largest].index()]);
-
-            heapify(largest);
+    std::vector<var> heap;
+    std::vector<int> position;
+
+    // tree navigation (0 based)
+    static size_type parent(size_type i)      { return (i-1) >> 2; }
+    static size_type first_child(size_type i) { return (i<<2) + 1; }
+
+    // the moved variable is kept aside, and the others shift into the hole
+    void sift_up( size_type pos ) {
+        var v = heap[pos];
+        double a = activity[v];
+        while ( pos > 0 && activity[heap[parent(pos)]] < a ) {
+            heap[pos] = heap[parent(pos)];
+            position[heap[pos]] = static_cast<int>(pos);
+            pos = parent(pos);
         }
+        heap[pos] = v;
+        position[v] = static_cast<int>(pos);
     }
 
-    void increase_key( size_type pos ) {
-        while ( pos > 0 && activity[value[father(pos)].index()] < activity[value[pos].index()] ) {
-            std::swap(value[pos],value[father(pos)]);
-            std::swap(map_position[value[pos].index()],
-                    map_position[value[father(pos)].index()]);
-            pos = father(pos);
+    void sift_down( size_type pos ) {
+        if ( pos >= heap.size() ) return;
+        var v = heap[pos];
+        double a = activity[v];
+        while ( true ) {
+            size_type child = first_child(pos);
+            if ( child >= heap.size() ) break;
+
+            // the most active of the (up to) 4 children
+            size_type last = std::min(child + 4, heap.size());
+            size_type largest = child;
+            for ( size_type c = child + 1; c < last; ++c )
+                if ( activity[heap[largest]] < activity[heap[c]] )
+                    largest = c;
+
+            if ( ! (a < activity[heap[largest]]) ) break;
+            heap[pos] = heap[largest];
+            position[heap[pos]] = static_cast<int>(pos);
+            pos = largest;
         }
+        heap[pos] = v;
+        position[v] = static_cast<int>(pos);
     }
 };
 
 /**
- * implementation of the VSIDS heuristic for literal selection
+ * implementation of the VSIDS heuristic for variable selection. Every
+ * unassigned variable is in the heap, the assigned ones are removed lazily
+ * when they reach the top
  */
-class Literal_Order {
+class Variable_Order {
 
 public:
-    Literal_Order( const std::vector<double> &act,
+    Variable_Order( const std::vector<double> &act,
             const std::vector<literal_value> &as):
-        assignment(as), order(act) {}
+        assignment(as), order(act), vars(), removed() {}
+
+    var decision() {
+        var v;
+        do { v = order.pop_max(); }
+        while( assignment[v] != LIT_UNASIGNED || removed[v] );
+        return v;
+    }
 
-    Literal decision() {
-        Literal l;
-        do { l = order.pop_max(); } while(assignment[l.var()] != LIT_UNASIGNED);
-        return l;
+    void increase_activity( var v ) {
+        order.update(v);
     }
 
-    void increase_activity( Literal l ) {
-        order.update(l);
+    void insert( var v ) {
+        if ( ! removed[v] ) order.insert(v);
     }
 
-    void insert(int value) {
-        order.insert(Literal(value,true ));
-        order.insert(Literal(value,false));
+    // a removed variable is never decided (e.g. it is eliminated)
+    void remove( var v ) { removed[v] = true; }
+    void restore( var v ) {
+        removed[v] = false;
+        order.insert(v);
     }
 
     void set_size(unsigned int s) {
         order.set_size(s);
+        removed.resize(s, false);
     }
 
+    // rebuild the heap with all the unassigned variables
     void initialize_heap() {
-        order.initialize();
+        vars.clear();
+        for ( var v = 0; v < static_cast<var>(assignment.size()); ++v )
+            if ( assignment[v] == LIT_UNASIGNED && ! removed[v] )
+                vars.push_back(v);
+        order.build(vars);
     }
 
 private:
     const std::vector<literal_value> &assignment;
-    Literal_Heap order;
+    Variable_Heap order;
+    std::vector<var> vars;
+    std::vector<bool> removed;
 };
 
 } // end namespace Satyricon
@@ -5,8 +5,15 @@
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
 #include "ArgumentParser.hpp"
+#include "cube_solver.hpp"
 #include "dimacs_parser.hpp"
+#include "metrics_server.hpp"
+#include "portfolio.hpp"
+#include "proof_writer.hpp"
 #include "sat_solver.hpp"
 #include <stdlib.h>
 
@@ -30,10 +37,18 @@ std::string program_description =
 "is used for evaluate the activity of a learned clause, and clauses with low "
 "activity are periodically removed from the problem.\n"
 "The program periodically restart the searching process keeping all the "
-"learned information.\n"
+"learned information, the restarts follow the luby sequence, the quality of "
+"the learned clauses, or alternate the two in focused and stable phases.\n"
+"With more than one thread, a portfolio of solvers with different search "
+"parameters runs in parallel on the same problem, and the first answer "
+"stops all the others.\n"
+"In cube and conquer mode a lookahead split the problem in many cubes "
+"(partial assignments), and the threads solve them under assumptions.\n"
 "A preprocessing step is applied to the problem before the resolution, in "
-"which a clause that can be subsumed by a more general one are eliminated from "
-"the formula.\n"
+"which the failed literals are found by probing, the equivalent literals are "
+"replaced by a single one, a clause that can be subsumed by a more general one "
+"are eliminated from the formula, and the variables are eliminated by "
+"resolution when this doesn't increase the number of clauses.\n"
 "It is possible to change and/or disable all this features from the command "
 "line interace, as described in the 'Options' section.\n"
 "If requested, the program can build a proof of the "
@@ -42,7 +57,6 @@ std::string program_description =
 "the clauses." ;
 
 std::chrono::time_point<std::chrono::steady_clock> start; // NOLINT(cert-err58-cpp)
-Satyricon::SATSolver solver;  // NOLINT(cert-err58-cpp)
 
 void signalHandler( int signum ) {
     //TODO: print solver status
@@ -57,6 +71,32 @@ void signalHandler( int signum ) {
     std::_Exit(1); // quick exit
 }
 
+// the first solver of a portfolio keep the given options, the others are
+// diversified
+void prepare(Satyricon::PortfolioSolver &solver) {
+    solver.diversify();
+}
+
+// the workers of a cube and conquer solver are quiet, a line for each cube
+// would be too much
+void prepare(Satyricon::CubeSolver &solver) {
+    for ( size_t i = 0; i < solver.size(); ++i )
+        solver[i].set_log(0);
+}
+
+void report(Satyricon::PortfolioSolver &solver) {
+    if ( solver.size() > 1 ) {
+        std::cout << "answer found by solver " << solver.get_winner() << "\n";
+        std::cout << "shared clauses: " << solver.get_exchanged_clauses() <<
+            ", imported: " << solver.get_imported_clauses() << "\n";
+    }
+}
+
+void report(Satyricon::CubeSolver &solver) {
+    std::cout << "cubes: " << solver.get_cubes() << ", refuted: " <<
+        solver.get_refuted_cubes() << "\n";
+}
+
 /**
  * SAT solver from CLI
  */
@@ -89,6 +129,27 @@ int main(int argc, char* argv[])
     auto& print_proof = parser.make_flag("print_proof",
             "print proof (both for sat and unsat)",{"p","proof"});
 
+    // DRAT proof of unsatisfiability
+    auto& drat_opt = parser.make_option<string>("proof file",
+            "write a DRAT proof of unsatisfiability in the file (binary "
+            "format). Only with a single thread", {"drat"});
+    auto& drat_text = parser.make_flag("drat_text",
+            "write the DRAT proof in the textual format", {"drat-text"});
+
+    // progress of the search
+    auto& json_progress = parser.make_flag("json_progress",
+            "print the progress of the search as JSON lines (one for each "
+            "solver, with its statistics) instead of the status lines",
+            {"json-progress"});
+    double progress_interval = 1.0;
+    auto& progress_opt = parser.make_option<double>("progress interval",
+            "seconds between two progress reports (default "+
+            to_string(progress_interval)+")", {"progress-interval"});
+    auto& metrics_opt = parser.make_option<string>("metrics address",
+            "serve the statistics of the solvers in the Prometheus format, "
+            "on a port of localhost or on a Unix socket (unix:PATH)",
+            {"metrics"});
+
     // disable feature (for testing purpose)
     auto& no_preproc = parser.make_flag("no_preprocessing",
             "disable preprocessing of clause",{"no-preprocessing"});
@@ -102,6 +163,15 @@ int main(int argc, char* argv[])
     auto& no_cc_reduction = parser.make_flag("no_cc_reduction",
             "disable reduction of the conflict clause",
             {"no-cc-reduction"});
+    auto& no_target_phase = parser.make_flag("no_target_phase",
+            "disable the decision with the phases of the longest conflict "
+            "free assignment", {"no-target-phase"});
+    auto& no_rephase = parser.make_flag("no_rephase",
+            "disable the periodic reset of the saved phases",
+            {"no-rephase"});
+    auto& no_vivification = parser.make_flag("no_vivification",
+            "disable the vivification of the learned clauses",
+            {"no-vivification"});
 
     // decay policy
     float decay_literal_factor = 0.95, decay_clauses_factor = 0.999;
@@ -115,9 +185,14 @@ int main(int argc, char* argv[])
             std::to_string(decay_literal_factor)+")",{"l-decay"});
 
     // restarting policy
+    Satyricon::restart_mode restart_policy = Satyricon::RESTART_STABLE;
+    auto& restart_opt = parser.make_option<string>("restart policy",
+            "restart policy: luby (luby sequence), glucose (moving averages "
+            "of the glue) or stable (alternate glucose and luby phases) "
+            "(default stable)", {"r","restart"});
     unsigned int restart_interval_multiplier = 100;
     auto& restart_mult = parser.make_option<unsigned int>("restart multiplier",
-            "restarting sequence multiplicator (default "+
+            "restarting sequence multiplicator, for the luby policy (default "+
             to_string(restart_interval_multiplier)+")", {"b","restart-mult"});
 
     // clause deletion policy
@@ -132,6 +207,49 @@ int main(int argc, char* argv[])
             "(default "+ to_string(percentual_learn_increase)+"%)",
             {"i","learn-increase"});
 
+    // portfolio
+    unsigned int threads = 1;
+    auto& threads_opt = parser.make_option<unsigned int>("threads",
+            "number of solvers in the parallel portfolio, each one with "
+            "different search parameters (default "+ to_string(threads)+")",
+            {"t","threads"});
+
+    // clause sharing between the solvers of the portfolio
+    auto& no_sharing = parser.make_flag("no_sharing",
+            "disable the exchange of learned clauses between threads",
+            {"no-sharing"});
+    unsigned int share_size = 8, share_lbd = 2;
+    float share_rate = 0.5;
+    auto& share_size_opt = parser.make_option<unsigned int>("share size",
+            "learned clauses with at most this number of literals are shared "
+            "with the other threads (default "+ to_string(share_size)+")",
+            {"share-size"});
+    auto& share_lbd_opt = parser.make_option<unsigned int>("share lbd",
+            "learned clauses with a literal block distance of at most this "
+            "value are shared with the other threads (default "+
+            to_string(share_lbd)+")", {"share-lbd"});
+    auto& share_rate_opt = parser.make_option<float>("share rate",
+            "maximum number of clauses exported by a thread for each "
+            "conflict (default "+ to_string(share_rate)+")", {"share-rate"});
+
+    // cube and conquer
+    auto& cube = parser.make_flag("cube",
+            "cube and conquer mode: a lookahead split the formula in cubes, "
+            "that are solved by the threads", {"cube"});
+    unsigned int cube_depth = 12, cube_candidates = 32;
+    float cube_cutoff = 0.5;
+    auto& cube_depth_opt = parser.make_option<unsigned int>("cube depth",
+            "maximum number of decisions in a cube (default "+
+            to_string(cube_depth)+")", {"cube-depth"});
+    auto& cube_cutoff_opt = parser.make_option<float>("cube cutoff",
+            "a cube is not split when this fraction of the variables is "
+            "assigned.\nShould be 0 < cube-cutoff ≤ 1.0 (default "+
+            to_string(cube_cutoff)+")", {"cube-cutoff"});
+    auto& cube_candidates_opt = parser.make_option<unsigned int>(
+            "lookahead candidates", "number of variables evaluated by the "
+            "lookahead for each split (default "+ to_string(cube_candidates)+
+            ")", {"cube-candidates"});
+
     // parsing argument
     try {
         parser.parseCLI(argc,argv);
@@ -147,19 +265,15 @@ int main(int argc, char* argv[])
         return 0;
     }
 
-    // redirect input file
-    std::ifstream ifstr;
-    std::istream is(nullptr);
+    // input file, "-" is the standard input
+    string input_file = "-";
     if ( in ) {
-        ifstr.open(in.get_value());
-        if ( ! ifstr.good() ) {
-            cout << "ERROR: file " << in.get_value() << " doesn't exist\n";
+        input_file = in.get_value();
+        if ( ! std::ifstream(input_file).good() ) {
+            cout << "ERROR: file " << input_file << " doesn't exist\n";
             exit(0);
         }
-        is.rdbuf(ifstr.rdbuf());
     }
-    else
-        is.rdbuf(cin.rdbuf());
 
     // decay values
     if ( clause_decay ) {
@@ -179,6 +293,21 @@ int main(int argc, char* argv[])
         decay_literal_factor = decay;
     }
 
+    // restarting policy
+    if ( restart_opt ) {
+        if ( restart_opt.get_value() == "luby" )
+            restart_policy = Satyricon::RESTART_LUBY;
+        else if ( restart_opt.get_value() == "glucose" )
+            restart_policy = Satyricon::RESTART_GLUCOSE;
+        else if ( restart_opt.get_value() == "stable" )
+            restart_policy = Satyricon::RESTART_STABLE;
+        else {
+            cout << "ERROR: should be restart = luby, glucose or stable\n"
+                << parser;
+            exit(1);
+        }
+    }
+
     // restarting multiplier value
     if ( restart_mult ) { 
         if ( restart_mult.get_value() < 1.0 ) {
@@ -204,69 +333,223 @@ int main(int argc, char* argv[])
         percentual_learn_increase = learn_increase.get_value();
     }
 
-// -----------------------------------------------------------------------------
-
-    // SOLVER
+    // portfolio size
+    if ( threads_opt ) {
+        if ( threads_opt.get_value() < 1 ) {
+            cout << "ERROR: should be threads ≥ 1\n" << parser;
+            exit(1);
+        }
+        threads = threads_opt.get_value();
+    }
 
-    solver.set_log(verbose ? 2 : 1);
+    // clause sharing
+    if ( share_size_opt ) share_size = share_size_opt.get_value();
+    if ( share_lbd_opt ) share_lbd = share_lbd_opt.get_value();
+    if ( share_rate_opt ) {
+        if ( share_rate_opt.get_value() < 0.0 ) {
+            cout << "ERROR: should be share-rate ≥ 0.0\n" << parser;
+            exit(1);
+        }
+        share_rate = share_rate_opt.get_value();
+    }
 
-    start = std::chrono::steady_clock::now();
+    // cube and conquer
+    if ( cube_depth_opt ) cube_depth = cube_depth_opt.get_value();
+    if ( cube_cutoff_opt ) {
+        float c = cube_cutoff_opt.get_value();
+        if ( c <= 0.0 || c > 1.0 ) {
+            cout << "ERROR: should be 0 < cube-cutoff ≤ 1.0\n" << parser;
+            exit(1);
+        }
+        cube_cutoff = c;
+    }
+    if ( cube_candidates_opt ) {
+        if ( cube_candidates_opt.get_value() < 1 ) {
+            cout << "ERROR: should be cube-candidates ≥ 1\n" << parser;
+            exit(1);
+        }
+        cube_candidates = cube_candidates_opt.get_value();
+    }
 
-    // parsing file
-    try {
-        bool conflict = Satyricon::parse_file(solver,is);
-
-        // get initilization time
-        auto init_time = std::chrono::steady_clock::now();
-        std::chrono::duration<float> elapsed = init_time - start;
-        std::cout << "read file and initialized solver in: " <<
-            std::fixed << std::setprecision(2) << elapsed.count() << "s\n";
-
-        // if found a conflict at level zero, report the conflict
-        if ( conflict ) {
-            std::cout << "found a conflict during solver construction\n";
-            std::cout << "UNSATISFIABLE" << endl;
-            return 0;
+    // progress
+    if ( progress_opt ) {
+        if ( progress_opt.get_value() <= 0.0 ) {
+            cout << "ERROR: should be progress-interval > 0.0\n" << parser;
+            exit(1);
         }
+        progress_interval = progress_opt.get_value();
     }
-    catch (const exception& e) {
-        cout << "Error parsing the file: " << e.what() << endl;
-        return 1;
+    std::unique_ptr<Satyricon::Metrics_Server> metrics;
+    if ( metrics_opt ) {
+        try {
+            metrics.reset(new Satyricon::Metrics_Server(
+                        metrics_opt.get_value()));
+        }
+        catch (const exception& e) {
+            cout << "ERROR: " << e.what() << endl;
+            exit(1);
+        }
     }
-    // set options in solver
-
-    // disable features
-    if ( no_preproc  ) solver.set_preprocessing(false);
-    if ( no_restart  ) solver.set_restart(false);
-    if ( no_deletion ) solver.set_deletion(false);
-    if ( no_random_choice ) solver.set_random_choice(false);
-    if ( no_cc_reduction ) solver.set_conflict_clause_reduction(false);
-    
-    // decaying factor
-    solver.set_clause_decay(decay_clauses_factor);
-    solver.set_literal_decay(decay_literal_factor);
 
-    // clause deletion
-    solver.set_learning_multiplier( initial_learn_mult );
-    solver.set_learning_increase( percentual_learn_increase );
+    // a JSON line with the statistics of a solver, the solvers of a
+    // portfolio report from their own threads
+    std::mutex output_mutex;
+    auto print_progress = [&](size_t i, const Satyricon::SolverStats &s,
+            bool final) {
+        std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+        std::ostringstream line;
+        line << "{\"solver\":" << i << ",\"time\":" << std::fixed <<
+            std::setprecision(3) << elapsed.count() << ",\"final\":" <<
+            (final ? "true" : "false") << ",\"stats\":" <<
+            Satyricon::to_json(s) << "}\n";
+        std::lock_guard<std::mutex> lock(output_mutex);
+        cout << line.str() << std::flush;
+    };
+
+    // proof, the clauses of a portfolio or of a cube are not derivable by
+    // a single solver
+    std::unique_ptr<Satyricon::Proof_Writer> proof;
+    if ( drat_opt ) {
+        if ( threads > 1 || cube ) {
+            cout << "ERROR: the DRAT proof requires a single thread\n"
+                << parser;
+            exit(1);
+        }
+        try {
+            proof.reset(new Satyricon::Proof_Writer(drat_opt.get_value(),
+                        ! drat_text));
+        }
+        catch (const exception& e) {
+            cout << "ERROR: " << e.what() << endl;
+            exit(1);
+        }
+    }
 
-    // restarting policy
-    solver.set_restarting_multiplier(restart_interval_multiplier);
+    // write the whole proof before the result, false if the write failed
+    auto close_proof = [&]() {
+        if ( ! proof ) return true;
+        try {
+            proof->close();
+        }
+        catch (const exception& e) {
+            cout << "ERROR: " << e.what() << endl;
+            return false;
+        }
+        return true;
+    };
+
+// -----------------------------------------------------------------------------
 
-    // solve the formula
-    bool satisfiable = solver.solve();
+    // SOLVER
 
-    // print exec time
-    auto end_time = std::chrono::steady_clock::now();
-    std::chrono::duration<double> elapsed = end_time - start;
-    std::cout << "completed in: " << std::fixed << std::setprecision(2) <<
-        elapsed.count() << "s\n";
+    // parse the file, configure the solvers and solve the formula. The same
+    // steps are used for the portfolio and for the cube and conquer solver
+    auto run = [&](auto &solver) {
+        for ( size_t i = 0; i < solver.size(); ++i ) {
+            solver[i].set_log(verbose ? 2 : json_progress ? 0 : 1);
+            solver[i].set_proof(proof.get());
+            if ( json_progress || metrics )
+                solver[i].set_progress(progress_interval,
+                        [&, i](const Satyricon::SolverStats &s) {
+                            if ( json_progress ) print_progress(i, s, false);
+                            if ( metrics ) metrics->publish(i, s);
+                        });
+        }
+
+        start = std::chrono::steady_clock::now();
+
+        // parsing file
+        try {
+            bool conflict = Satyricon::parse_file(solver,input_file);
+
+            // get initilization time
+            auto init_time = std::chrono::steady_clock::now();
+            std::chrono::duration<float> elapsed = init_time - start;
+            std::cout << "read file and initialized solver in: " <<
+                std::fixed << std::setprecision(2) << elapsed.count() << "s\n";
+
+            // if found a conflict at level zero, report the conflict
+            if ( conflict ) {
+                if ( ! close_proof() ) return 1;
+                std::cout << "found a conflict during solver construction\n";
+                std::cout << "UNSATISFIABLE" << endl;
+                return 0;
+            }
+        }
+        catch (const exception& e) {
+            cout << "Error parsing the file: " << e.what() << endl;
+            return 1;
+        }
+        // set options in solvers
+        for ( size_t i = 0; i < solver.size(); ++i ) {
+            Satyricon::SATSolver &s = solver[i];
+
+            // disable features
+            if ( no_preproc  ) s.set_preprocessing(false);
+            if ( no_restart  ) s.set_restart(false);
+            if ( no_deletion ) s.set_deletion(false);
+            if ( no_random_choice ) s.set_random_choice(false);
+            if ( no_cc_reduction ) s.set_conflict_clause_reduction(false);
+            if ( no_target_phase ) s.set_target_phase(false);
+            if ( no_rephase ) s.set_rephase(false);
+            if ( no_vivification ) s.set_vivification(false);
+
+            // decaying factor
+            s.set_clause_decay(decay_clauses_factor);
+            s.set_literal_decay(decay_literal_factor);
+
+            // clause deletion
+            s.set_learning_multiplier( initial_learn_mult );
+            s.set_learning_increase( percentual_learn_increase );
+
+            // restarting policy
+            s.set_restart_policy(restart_policy);
+            s.set_restarting_multiplier(restart_interval_multiplier);
+
+            // clause sharing
+            s.set_sharing_limits(share_size, share_lbd);
+            s.set_sharing_rate(share_rate);
+        }
+        if ( no_sharing ) solver.set_clause_sharing(false);
+
+        prepare(solver);
+
+        // solve the formula
+        bool satisfiable = solver.solve();
+        if ( ! close_proof() ) return 1;
+        for ( size_t i = 0; i < solver.size(); ++i ) {
+            if ( json_progress ) print_progress(i, solver[i].get_stats(), true);
+            if ( metrics ) metrics->publish(i, solver[i].get_stats());
+        }
+
+        // print exec time
+        auto end_time = std::chrono::steady_clock::now();
+        std::chrono::duration<double> elapsed = end_time - start;
+        std::cout << "completed in: " << std::fixed << std::setprecision(2) <<
+            elapsed.count() << "s\n";
+
+        // print result
+        report(solver);
+        if ( proof )
+            std::cout << "proof: " << proof->lemmas() << " lemmas, " <<
+                proof->deletions() << " deletions\n";
+        std::cout << (satisfiable ? "SATISFIABLE" : "UNSATISFIABLE") << endl;
+        if ( print_proof && satisfiable )
+            std::cout << "Model: " << endl << solver.string_model() << endl;
 
-    // print result
-    std::cout << (satisfiable ? "SATISFIABLE" : "UNSATISFIABLE") << endl;
-    if ( print_proof && satisfiable )
-        std::cout << "Model: " << endl << solver.string_model() << endl;
+        return 0;
+    };
+
+    if ( cube ) {
+        Satyricon::CubeSolver solver(threads);
+        solver.set_depth(cube_depth);
+        solver.set_cutoff(cube_cutoff);
+        solver.set_candidates(cube_candidates);
+        return run(solver);
+    }
 
-    return 0;
+    Satyricon::PortfolioSolver solver(threads);
+    return run(solver);
 }
 
@@ -0,0 +1,76 @@
+#include "clause_exchange.hpp"
+
+namespace Satyricon {
+
+// the sequence of a slot is 2*ticket+1 while the clause with that ticket is
+// written, and 2*ticket+2 when it is published (0 for an empty slot)
+
+Clause_Exchange::Clause_Exchange(size_t c) :
+    slots(new Slot[c]), capacity(c), head(0)
+{
+    assert( capacity > 0 );
+    for ( size_t i = 0; i < capacity; ++i )
+        slots[i].sequence.store(0, std::memory_order_relaxed);
+}
+
+bool Clause_Exchange::publish(unsigned int producer,
+        const std::vector<Literal> &c) {
+    if ( c.empty() || c.size() > max_clause_size ) return false;
+
+    uint64_t ticket = head.fetch_add(1, std::memory_order_relaxed);
+    Slot &slot = slots[ticket % capacity];
+
+    // take the slot, give up if another producer is writing it or if it
+    // already contain a newer clause
+    uint64_t seq = slot.sequence.load(std::memory_order_relaxed);
+    if ( (seq & 1) || seq > 2*ticket ||
+            ! slot.sequence.compare_exchange_strong(seq, 2*ticket+1,
+                std::memory_order_acquire, std::memory_order_relaxed) )
+        return false;
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot.producer.store(producer, std::memory_order_relaxed);
+    slot.size.store(static_cast<uint32_t>(c.size()), std::memory_order_relaxed);
+    for ( size_t i = 0; i < c.size(); ++i )
+        slot.literals[i].store(c[i].index(), std::memory_order_relaxed);
+
+    slot.sequence.store(2*ticket+2, std::memory_order_release);
+    return true;
+}
+
+size_t Clause_Exchange::collect(unsigned int consumer, uint64_t &cursor,
+        const std::function<void(std::vector<Literal>&)> &f) {
+    uint64_t end = head.load(std::memory_order_acquire);
+
+    // the clauses older than the capacity are already overwritten
+    if ( end - cursor > capacity ) cursor = end - capacity;
+
+    size_t imported = 0;
+    std::vector<Literal> buffer;
+    for ( ; cursor < end; ++cursor ) {
+        Slot &slot = slots[cursor % capacity];
+
+        // skip the clauses not yet published or already overwritten
+        uint64_t seq = slot.sequence.load(std::memory_order_acquire);
+        if ( seq != 2*cursor+2 ) continue;
+
+        uint32_t producer = slot.producer.load(std::memory_order_relaxed);
+        uint32_t size = slot.size.load(std::memory_order_relaxed);
+        if ( size > max_clause_size ) continue;
+        buffer.clear();
+        for ( size_t i = 0; i < size; ++i )
+            buffer.push_back(Literal::from_index(
+                        slot.literals[i].load(std::memory_order_relaxed)));
+
+        // the slot must not have changed during the copy
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if ( slot.sequence.load(std::memory_order_relaxed) != seq ) continue;
+        if ( producer == consumer ) continue;
+
+        f(buffer);
+        ++imported;
+    }
+    return imported;
+}
+
+} // end namespace Satyricon
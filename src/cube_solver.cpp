@@ -0,0 +1,262 @@
+#include <algorithm>
+#include <numeric>
+#include <thread>
+#include "cube_solver.hpp"
+
+namespace Satyricon {
+
+CubeSolver::CubeSolver(unsigned int number_of_workers) :
+    workers(), exchange(), clause_copy(), max_depth(12), cutoff(0.5),
+    number_of_candidates(32), ranking(), cubes(), queues(), stop(false),
+    satisfiable(false), refuted(0), winner(0)
+{
+    assert( number_of_workers > 0 );
+    for ( unsigned int i = 0; i < number_of_workers; ++i ) {
+        workers.emplace_back(new SATSolver());
+        workers.back()->set_interrupt(&stop);
+        workers.back()->set_random_seed(i);
+        // the cubes can contain any variable, none can be eliminated
+        workers.back()->set_preprocessing(false);
+    }
+    set_clause_sharing(true);
+}
+
+void CubeSolver::set_number_of_variable(unsigned int n) {
+    for ( auto & s : workers ) s->set_number_of_variable(n);
+}
+
+void CubeSolver::reserve_clauses(unsigned int n) {
+    for ( auto & s : workers ) s->reserve_clauses(n);
+}
+
+bool CubeSolver::add_clause(std::vector<Literal>& c) {
+    // a solver simplify the clause in place, so every worker get a copy
+    bool conflict = false;
+    for ( auto & s : workers ) {
+        clause_copy = c;
+        conflict = s->add_clause(clause_copy);
+    }
+    return conflict;
+}
+
+void CubeSolver::set_depth(unsigned int d) {
+    max_depth = d;
+}
+
+void CubeSolver::set_cutoff(double c) {
+    assert( c > 0.0 && c <= 1.0 );
+    cutoff = c;
+}
+
+void CubeSolver::set_candidates(unsigned int c) {
+    assert( c > 0 );
+    number_of_candidates = c;
+}
+
+void CubeSolver::set_clause_sharing(bool s) {
+    // the clauses learned under a cube don't depend on the cube, so they
+    // are valid for all the workers
+    if ( s && workers.size() > 1 ) {
+        exchange.reset(new Clause_Exchange());
+        for ( size_t i = 0; i < workers.size(); ++i )
+            workers[i]->set_clause_exchange(exchange.get(),
+                    static_cast<unsigned int>(i));
+    }
+    else {
+        for ( auto & worker : workers )
+            worker->set_clause_exchange(nullptr, 0);
+        exchange.reset();
+    }
+}
+
+void CubeSolver::select_candidates(SATSolver &s, std::vector<int> &candidates) {
+    candidates.clear();
+    for ( int v : ranking ) {
+        if ( candidates.size() == number_of_candidates ) break;
+        if ( s.get_value(Literal(v,false)) == LIT_UNASIGNED )
+            candidates.push_back(v);
+    }
+}
+
+void CubeSolver::split(SATSolver &s, std::vector<Literal> &cube,
+        unsigned int depth) {
+    size_t cube_size = cube.size();
+    unsigned int level = s.get_decision_level();
+
+    // refuted cubes are dropped, so when a cube is abandoned the solver and
+    // the cube must return as they were
+    auto restore = [&]() {
+        s.backtrack(level);
+        cube.resize(cube_size);
+    };
+
+    bool leaf = depth >= max_depth || static_cast<double>(
+            s.get_assigned_variables()) >= cutoff * s.get_number_of_variable();
+    if ( leaf ) {
+        cubes.push_back(cube);
+        return;
+    }
+
+    // the score of a variable is the product of the number of literals
+    // implied by its two polarities, so balanced variables are preferred
+    std::vector<int> candidates;
+    select_candidates(s, candidates);
+    int best = -1;
+    double best_score = -1.0;
+    for ( int v : candidates ) {
+        // may be implied by a failed literal
+        if ( s.get_value(Literal(v,false)) != LIT_UNASIGNED ) continue;
+
+        unsigned int current = s.get_decision_level();
+        size_t base = s.get_assigned_variables();
+        bool positive_conflict = s.propagate_literal(Literal(v,false));
+        size_t positive = s.get_assigned_variables() - base;
+        s.backtrack(current);
+        bool negative_conflict = s.propagate_literal(Literal(v,true));
+        size_t negative = s.get_assigned_variables() - base;
+        s.backtrack(current);
+
+        if ( positive_conflict && negative_conflict ) {
+            restore();
+            return; // the cube is unsatisfiable
+        }
+        if ( positive_conflict || negative_conflict ) {
+            // failed literal: the opposite polarity is implied by the cube
+            Literal implied(v, positive_conflict);
+            if ( s.propagate_literal(implied) ) {
+                restore();
+                return;
+            }
+            cube.push_back(implied);
+            continue;
+        }
+
+        double score = static_cast<double>(positive + 1) *
+            static_cast<double>(negative + 1);
+        if ( score > best_score ) {
+            best_score = score;
+            best = v;
+        }
+    }
+
+    if ( best == -1 ) {
+        // everything is assigned, the cube is complete
+        cubes.push_back(cube);
+        restore();
+        return;
+    }
+
+    unsigned int current = s.get_decision_level();
+    for ( bool sign : { false, true } ) {
+        Literal l(best, sign);
+        if ( ! s.propagate_literal(l) ) {
+            cube.push_back(l);
+            split(s, cube, depth + 1);
+            cube.pop_back();
+        }
+        s.backtrack(current);
+    }
+    restore();
+}
+
+bool CubeSolver::next_cube(size_t id, size_t &cube) {
+    // take the next cube from the own queue
+    {
+        std::lock_guard<std::mutex> lock(queues[id].mutex);
+        if ( ! queues[id].cubes.empty() ) {
+            cube = queues[id].cubes.front();
+            queues[id].cubes.pop_front();
+            return true;
+        }
+    }
+
+    // or steal the last cube of another worker
+    for ( size_t i = 1; i < workers.size(); ++i ) {
+        Work_Queue &victim = queues[(id + i) % workers.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if ( ! victim.cubes.empty() ) {
+            cube = victim.cubes.back();
+            victim.cubes.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
+
+void CubeSolver::conquer(size_t id) {
+    SATSolver &s = *workers[id];
+    size_t cube;
+    while ( ! stop && next_cube(id, cube) ) {
+        bool result = s.solve(cubes[cube]);
+        if ( s.interrupted() ) return;
+
+        if ( result ) {
+            // the first satisfiable cube stop the others
+            bool expected = false;
+            if ( satisfiable.compare_exchange_strong(expected, true) ) {
+                winner = id;
+                stop = true;
+            }
+            return;
+        }
+
+        refuted++;
+        // a conflict without assumptions refute all the cubes
+        if ( s.proved_unsat() ) {
+            stop = true;
+            return;
+        }
+    }
+}
+
+bool CubeSolver::solve() {
+    stop = false;
+    satisfiable = false;
+    refuted = 0;
+    winner = 0;
+    cubes.clear();
+
+    // the variables that appear in more clauses are the first candidates
+    SATSolver &lookahead = *workers[0];
+    ranking.resize(lookahead.get_number_of_variable());
+    std::iota(ranking.begin(), ranking.end(), 0);
+    std::stable_sort(ranking.begin(), ranking.end(),
+            [&lookahead](int a, int b) {
+                return lookahead.get_activity(a) > lookahead.get_activity(b);
+            });
+
+    // lookahead phase
+    std::vector<Literal> cube;
+    split(lookahead, cube, 0);
+    lookahead.backtrack(0);
+    if ( cubes.empty() ) return false; // every cube is refuted
+
+    // neighbouring cubes share their first decisions, so every worker
+    // start with a contiguous range of cubes
+    queues.reset(new Work_Queue[workers.size()]);
+    for ( size_t i = 0; i < cubes.size(); ++i )
+        queues[i * workers.size() / cubes.size()].cubes.push_back(i);
+
+    // conquer phase
+    if ( workers.size() == 1 ) {
+        conquer(0);
+        return satisfiable;
+    }
+
+    std::vector<std::thread> threads;
+    for ( size_t i = 0; i < workers.size(); ++i )
+        threads.emplace_back([this, i]() { conquer(i); });
+    for ( auto & t : threads ) t.join();
+
+    return satisfiable;
+}
+
+const std::vector<int>& CubeSolver::get_model() {
+    return workers[winner]->get_model();
+}
+
+std::string CubeSolver::string_model() {
+    return workers[winner]->string_model();
+}
+
+} // end namespace Satyricon
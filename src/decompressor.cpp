@@ -0,0 +1,275 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include "decompressor.hpp"
+
+#ifdef SATYRICON_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef SATYRICON_HAVE_LZMA
+#include <lzma.h>
+#endif
+#ifdef SATYRICON_HAVE_BZIP2
+#include <bzlib.h>
+#endif
+
+namespace Satyricon {
+
+namespace {
+
+// size of the buffers used by the decoders
+const size_t buffer_size = 1 << 18;
+// maximum number of decompressed blocks waiting for the reader
+const size_t max_queued_blocks = 4;
+
+const char *format_name(compression_format f) {
+    switch (f) {
+        case COMPRESSION_GZIP:  return "gzip";
+        case COMPRESSION_XZ:    return "xz";
+        case COMPRESSION_BZIP2: return "bzip2";
+        default:                return "plain";
+    }
+}
+
+/**
+ * Input buffer shared by all the decoders
+ */
+struct Decoder_Input {
+    explicit Decoder_Input(const Read_Function &r) :
+        read(r), buffer(buffer_size), size(0), eof(false) {}
+
+    // read a new block, false at the end of the input
+    bool fill() {
+        if ( eof ) return false;
+        size = read(buffer.data(), buffer.size());
+        eof = ( size == 0 );
+        return ! eof;
+    }
+
+    const Read_Function &read;
+    std::vector<char> buffer;
+    size_t size;
+    bool eof;
+};
+
+void corrupted(compression_format f) {
+    throw std::domain_error(std::string("corrupted ") + format_name(f) +
+            " input");
+}
+
+#ifdef SATYRICON_HAVE_ZLIB
+void decompress_gzip(const Read_Function &read, const Write_Function &write) {
+    z_stream zs;
+    std::memset(&zs, 0, sizeof(zs));
+    // 15 + 32: maximum window, automatic detection of gzip or zlib header
+    if ( inflateInit2(&zs, 15 + 32) != Z_OK )
+        throw std::runtime_error("unable to initialize zlib");
+    struct Guard { z_stream &z; ~Guard() { inflateEnd(&z); } } guard{zs};
+
+    Decoder_Input in(read);
+    // read a new block in the stream, false at the end of the input
+    auto refill = [&]() {
+        if ( ! in.fill() ) return false;
+        zs.next_in = reinterpret_cast<Bytef*>(in.buffer.data());
+        zs.avail_in = static_cast<uInt>(in.size);
+        return true;
+    };
+
+    std::vector<char> out(buffer_size);
+    while ( true ) {
+        if ( zs.avail_in == 0 ) refill();
+        zs.next_out = reinterpret_cast<Bytef*>(out.data());
+        zs.avail_out = static_cast<uInt>(out.size());
+
+        int ret = inflate(&zs, Z_NO_FLUSH);
+        size_t produced = out.size() - zs.avail_out;
+        if ( produced != 0 && ! write(out.data(), produced) ) return;
+
+        if ( ret == Z_STREAM_END ) {
+            // a gzip file can contain multiple members
+            if ( zs.avail_in == 0 && ! refill() ) return;
+            inflateReset(&zs);
+        }
+        else if ( ret == Z_BUF_ERROR ) {
+            if ( zs.avail_in == 0 && in.eof ) corrupted(COMPRESSION_GZIP);
+        }
+        else if ( ret != Z_OK ) corrupted(COMPRESSION_GZIP);
+    }
+}
+#endif
+
+#ifdef SATYRICON_HAVE_LZMA
+void decompress_xz(const Read_Function &read, const Write_Function &write) {
+    lzma_stream ls = LZMA_STREAM_INIT;
+    if ( lzma_stream_decoder(&ls, UINT64_MAX, LZMA_CONCATENATED) != LZMA_OK )
+        throw std::runtime_error("unable to initialize liblzma");
+    struct Guard { lzma_stream &l; ~Guard() { lzma_end(&l); } } guard{ls};
+
+    Decoder_Input in(read);
+    std::vector<char> out(buffer_size);
+    while ( true ) {
+        lzma_action action = LZMA_RUN;
+        if ( ls.avail_in == 0 ) {
+            if ( in.fill() ) {
+                ls.next_in = reinterpret_cast<const uint8_t*>(in.buffer.data());
+                ls.avail_in = in.size;
+            }
+            else action = LZMA_FINISH;
+        }
+        ls.next_out = reinterpret_cast<uint8_t*>(out.data());
+        ls.avail_out = out.size();
+
+        lzma_ret ret = lzma_code(&ls, action);
+        size_t produced = out.size() - ls.avail_out;
+        if ( produced != 0 && ! write(out.data(), produced) ) return;
+
+        if ( ret == LZMA_STREAM_END ) return;
+        if ( ret != LZMA_OK ) corrupted(COMPRESSION_XZ);
+    }
+}
+#endif
+
+#ifdef SATYRICON_HAVE_BZIP2
+void decompress_bzip2(const Read_Function &read, const Write_Function &write) {
+    bz_stream bs;
+    std::memset(&bs, 0, sizeof(bs));
+    if ( BZ2_bzDecompressInit(&bs, 0, 0) != BZ_OK )
+        throw std::runtime_error("unable to initialize libbz2");
+    struct Guard {
+        bz_stream &b; ~Guard() { BZ2_bzDecompressEnd(&b); }
+    } guard{bs};
+
+    Decoder_Input in(read);
+    // read a new block in the stream, false at the end of the input
+    auto refill = [&]() {
+        if ( ! in.fill() ) return false;
+        bs.next_in = in.buffer.data();
+        bs.avail_in = static_cast<unsigned int>(in.size);
+        return true;
+    };
+
+    std::vector<char> out(buffer_size);
+    while ( true ) {
+        if ( bs.avail_in == 0 ) refill();
+        bs.next_out = out.data();
+        bs.avail_out = static_cast<unsigned int>(out.size());
+
+        int ret = BZ2_bzDecompress(&bs);
+        size_t produced = out.size() - bs.avail_out;
+        if ( produced != 0 && ! write(out.data(), produced) ) return;
+
+        if ( ret == BZ_STREAM_END ) {
+            // a bzip2 file can contain multiple streams
+            if ( bs.avail_in == 0 && ! refill() ) return;
+            char *next = bs.next_in;
+            unsigned int avail = bs.avail_in;
+            BZ2_bzDecompressEnd(&bs);
+            if ( BZ2_bzDecompressInit(&bs, 0, 0) != BZ_OK )
+                throw std::runtime_error("unable to initialize libbz2");
+            bs.next_in = next;
+            bs.avail_in = avail;
+        }
+        else if ( ret != BZ_OK ) corrupted(COMPRESSION_BZIP2);
+        else if ( bs.avail_in == 0 && in.eof && produced == 0 )
+            corrupted(COMPRESSION_BZIP2);
+    }
+}
+#endif
+
+} // end anonymous namespace
+
+compression_format detect_compression(const char *data, size_t size) {
+    const unsigned char *d = reinterpret_cast<const unsigned char*>(data);
+    if ( size >= 2 && d[0] == 0x1f && d[1] == 0x8b )
+        return COMPRESSION_GZIP;
+    if ( size >= 6 && std::memcmp(d, "\xfd" "7zXZ\0", 6) == 0 )
+        return COMPRESSION_XZ;
+    if ( size >= 3 && std::memcmp(d, "BZh", 3) == 0 )
+        return COMPRESSION_BZIP2;
+    return COMPRESSION_NONE;
+}
+
+void decompress(compression_format format, const Read_Function &in,
+        const Write_Function &out) {
+    switch (format) {
+#ifdef SATYRICON_HAVE_ZLIB
+        case COMPRESSION_GZIP:  decompress_gzip(in,out);  return;
+#endif
+#ifdef SATYRICON_HAVE_LZMA
+        case COMPRESSION_XZ:    decompress_xz(in,out);    return;
+#endif
+#ifdef SATYRICON_HAVE_BZIP2
+        case COMPRESSION_BZIP2: decompress_bzip2(in,out); return;
+#endif
+        default:
+            throw std::domain_error(std::string(format_name(format)) +
+                    " input is not supported by this build");
+    }
+}
+
+Decompression_Thread::Decompression_Thread(compression_format format,
+        Read_Function in) :
+    mutex(), not_empty(), not_full(), blocks(), current(), current_pos(0),
+    completed(false), cancelled(false), error(), worker()
+{
+    worker = std::thread([this, format, in]() {
+        try {
+            decompress(format, in, [this](const char *d, size_t s) {
+                    return push(d,s); });
+            finish(nullptr);
+        }
+        catch (...) {
+            finish(std::current_exception());
+        }
+    });
+}
+
+Decompression_Thread::~Decompression_Thread() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        cancelled = true;
+    }
+    not_full.notify_all();
+    worker.join();
+}
+
+bool Decompression_Thread::push(const char *data, size_t size) {
+    std::unique_lock<std::mutex> lock(mutex);
+    not_full.wait(lock, [this]() {
+            return cancelled || blocks.size() < max_queued_blocks; });
+    if ( cancelled ) return false;
+    blocks.emplace_back(data, data + size);
+    not_empty.notify_one();
+    return true;
+}
+
+void Decompression_Thread::finish(std::exception_ptr e) {
+    std::lock_guard<std::mutex> lock(mutex);
+    completed = true;
+    error = e;
+    not_empty.notify_one();
+}
+
+size_t Decompression_Thread::read(char *buffer, size_t size) {
+    // take a new block when the current one is consumed
+    if ( current_pos == current.size() ) {
+        std::unique_lock<std::mutex> lock(mutex);
+        not_empty.wait(lock, [this]() { return completed || !blocks.empty(); });
+        if ( blocks.empty() ) {
+            if ( error ) std::rethrow_exception(error);
+            return 0; // end of the input
+        }
+        current.swap(blocks.front());
+        blocks.pop_front();
+        current_pos = 0;
+        not_full.notify_one();
+    }
+
+    size_t n = std::min(size, current.size() - current_pos);
+    std::memcpy(buffer, current.data() + current_pos, n);
+    current_pos += n;
+    return n;
+}
+
+} // end namespace Satyricon
@@ -1,65 +1,380 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
 #include <exception>
 #include <fstream>
 #include <sstream>
 #include <string>
+#include <system_error>
 #include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "cube_solver.hpp"
+#include "decompressor.hpp"
 #include "dimacs_parser.hpp"
+#include "portfolio.hpp"
 #include "sat_solver.hpp"
 #include "solver_types.hpp"
 
 //using namespace std;
 //using namespace Satyricon;
 
-bool Satyricon::parse_file(SATSolver& solver, std::istream & is)
-{
-    unsigned int number_of_clausole = 0, number_of_variable = 0;
-    std::string line;
+namespace {
+
+using Satyricon::Literal;
+using Satyricon::Read_Function;
+using Satyricon::compression_format;
+using Satyricon::detect_compression;
+using Satyricon::compression_magic_size;
+using Satyricon::COMPRESSION_NONE;
+using Satyricon::Decompression_Thread;
+
+// size of a block when the input can't be mapped in memory
+const size_t block_size = 1 << 20;
+
+inline bool is_blank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+inline bool is_end_of_line(const char *p, const char *end) {
+    return p == end || *p == '\n';
+}
+
+inline const char *skip_blank(const char *p, const char *end) {
+    while ( p != end && is_blank(*p) ) ++p;
+    return p;
+}
+
+inline const char *skip_line(const char *p, const char *end) {
+    p = static_cast<const char*>(memchr(p, '\n', end - p));
+    return p == nullptr ? end : p + 1;
+}
+
+inline std::string rest_of_line(const char *p, const char *end) {
+    const char *e = p;
+    while ( !is_end_of_line(e,end) && *e != '\r' ) ++e;
+    return std::string(p, e);
+}
+
+/**
+ * Scan an integer in [p,end), p is moved after the integer. Return false if
+ * the text is not a number followed by a blank or by the end of the line.
+ * the value is limited to 18 digits, enough for any variable.
+ */
+inline bool scan_int(const char *&p, const char *end, long long &value) {
+    bool negative = (p != end && *p == '-');
+    p += negative;
+    const char *digits = p;
+    unsigned long long v = 0;
+    unsigned int d;
+    while ( p != end && (d = static_cast<unsigned char>(*p) - '0') < 10 ) {
+        v = v * 10 + d;
+        ++p;
+    }
+    value = negative ? -static_cast<long long>(v) : static_cast<long long>(v);
+    return p != digits && p - digits <= 18 &&
+        ( is_end_of_line(p,end) || is_blank(*p) );
+}
+
+/**
+ * DIMACS parser. The input is given in chunks of complete lines, so a token
+ * is never split between two chunks. The problem is loaded in a Solver
+ * (a SATSolver or a PortfolioSolver)
+ */
+template<typename Solver>
+class Parser {
+public:
+    explicit Parser(Solver &s) : solver(s), clause(),
+        number_of_variable(0), number_of_clausole(0), read_clausole(0),
+        header_found(false) {}
+
+    // parse all the lines in [p,end), return true if a conflict is found
+    bool parse(const char *p, const char *end) {
+        while ( p != end && ! completed() ) {
+            p = skip_blank(p,end);
+            if ( p == end ) break;
+            if ( *p == '\n' ) { ++p; continue; }         // empty line
+            if ( *p == 'c' )  { p = skip_line(p,end); continue; } // comment
+
+            if ( ! header_found ) {
+                p = parse_header(p, end);
+                continue;
+            }
+
+            // read clausoles, a clausole can span multiple lines
+            while ( ! completed() ) {
+                p = skip_blank(p,end);
+                if ( is_end_of_line(p,end) ) break;
+
+                const char *token = p;
+                long long value;
+                if ( ! scan_int(p, end, value) )
+                    throw std::domain_error("invalid simbol on clausole " +
+                            rest_of_line(token,end));
+                if ( value > number_of_variable || -value > number_of_variable)
+                    throw std::domain_error(std::string("invalid variable ") +
+                            std::string(token,p));
 
-    // find header line
-    while (getline(is, line)) {
-        if (line[0] == 'c') continue;
+                if ( value == 0 ) {
+                    read_clausole++;
+                    bool conflict = solver.add_clause(clause);
+                    clause.clear();
+                    if ( conflict ) return true; // found a conflict
+                }
+                else {
+                    int v = static_cast<int>(value < 0 ? -value : value);
+                    clause.push_back( Literal(v-1, value < 0) );
+                }
+            }
+        }
+        return false; // no conflict
+    }
 
-        std::istringstream iss(line);
-        std::string p, cnf, other;
+    // called when the whole input is read
+    void finish() {
+        if ( ! header_found ) solver.set_number_of_variable(0);
+    }
+
+private:
+    Solver &solver;
+    std::vector<Literal> clause;
+    long long number_of_variable, number_of_clausole, read_clausole;
+    bool header_found;
 
-        if ( !(iss >> p >> cnf >> number_of_variable >> number_of_clausole)
-                || (iss >> other) || p != "p" || cnf != "cnf")
+    bool completed() const {
+        return header_found && read_clausole >= number_of_clausole;
+    }
+
+    // parse the 'p cnf' line and initialize the solver
+    const char *parse_header(const char *p, const char *end) {
+        bool valid = scan_word(p,end,"p") && scan_word(p,end,"cnf") &&
+            scan_int(p,end,number_of_variable);
+        if ( valid ) {
+            p = skip_blank(p,end);
+            valid = scan_int(p,end,number_of_clausole);
+        }
+        p = skip_blank(p,end);
+        valid = valid && is_end_of_line(p,end) &&
+            number_of_variable >= 0 && number_of_variable <= INT32_MAX/2 &&
+            number_of_clausole >= 0;
+        if ( ! valid )
             throw std::domain_error(
                     "expected a 'p cnf NUMBER_OF_VARIABLE NUMBER_OF_CLAUSOLE'"
                     " as first line");
-        break;
+
+        header_found = true;
+        solver.set_number_of_variable(
+                static_cast<unsigned int>(number_of_variable));
+        solver.reserve_clauses(static_cast<unsigned int>(number_of_clausole));
+        return p;
     }
-    solver.set_number_of_variable(number_of_variable);
 
-    unsigned int read_clausole = 0;
-    // read clausoles
+    // scan a word followed by a blank, and move p to the next token
+    static bool scan_word(const char *&p, const char *end, const char *word) {
+        size_t n = std::strlen(word);
+        if ( static_cast<size_t>(end - p) <= n ||
+                std::strncmp(p,word,n) != 0 || ! is_blank(p[n]) )
+            return false;
+        p = skip_blank(p+n,end);
+        return true;
+    }
+};
 
-    std::vector<Literal> c;
-    int value;
+/**
+ * read the input in blocks with a read function and give to the parser only
+ * complete lines. read(buffer, size) return the number of read bytes, and 0
+ * at the end of the input
+ */
+template<typename Parser, typename ReadFunction>
+bool parse_blocks(Parser &parser, ReadFunction read) {
+    std::vector<char> buffer(block_size);
+    size_t filled = 0;
+    while ( true ) {
+        // make sure there is room for a new block, even for very long lines
+        if ( buffer.size() - filled < block_size / 2 )
+            buffer.resize(buffer.size() * 2);
 
-    while (getline(is, line) && read_clausole < number_of_clausole ) {
-        if ( line.size() == 0 || line[0] == 'c') continue;
+        size_t n = read(buffer.data() + filled, buffer.size() - filled);
+        filled += n;
 
-        std::istringstream iss(line);
+        // at the end of the input, parse everything
+        if ( n == 0 ) {
+            bool conflict = parser.parse(buffer.data(), buffer.data()+filled);
+            parser.finish();
+            return conflict;
+        }
 
-        while( !iss.eof() ) {
-            if ( !(iss >> value) )
-                throw std::domain_error("invalid simbol on clausole " + line);
-            if(static_cast<unsigned int>(abs(value)) > number_of_variable)
-                throw std::domain_error(std::string("invalid variable ")+std::to_string(value));
+        // otherwise parse up to the last complete line
+        const char *last = static_cast<const char*>(
+                memrchr(buffer.data(), '\n', filled));
+        if ( last == nullptr ) continue;
+        ++last;
+        if ( parser.parse(buffer.data(), last) ) return true;
 
-            if (value == 0) {
-                read_clausole++;
-                bool conflict = solver.add_clause(c);
-                c.clear();
-                if ( conflict ) return true; // found a conflict
-            }
-            else {
-                c.push_back( Literal(abs(value)-1, value < 0) );
+        // move the incomplete line at the beginning of the buffer
+        size_t used = last - buffer.data();
+        std::memmove(buffer.data(), last, filled - used);
+        filled -= used;
+    }
+}
+
+// close a file descriptor when leaving the scope
+struct File_Descriptor {
+    explicit File_Descriptor(int f) : fd(f) {}
+    ~File_Descriptor() { if ( fd > STDIN_FILENO ) close(fd); }
+    int fd;
+};
+
+// unmap a file when leaving the scope
+struct Memory_Map {
+    Memory_Map(void *a, size_t l) : addr(a), length(l) {}
+    ~Memory_Map() { munmap(addr, length); }
+    void *addr;
+    size_t length;
+};
+
+/**
+ * parse a raw input. A compressed input is decompressed on a separate
+ * thread, so the decompression and the parsing overlap
+ */
+template<typename Solver>
+bool parse_input(Solver &solver, const Read_Function &raw) {
+    Parser<Solver> parser(solver);
+
+    // read the first bytes to detect the compression format
+    std::vector<char> head(block_size);
+    size_t head_size = 0, head_pos = 0, n;
+    while ( head_size < compression_magic_size &&
+            (n = raw(head.data() + head_size, head.size() - head_size)) != 0 )
+        head_size += n;
+
+    // the first bytes are read again before the rest of the input
+    Read_Function input = [&](char *buffer, size_t size) {
+        if ( head_pos == head_size ) return raw(buffer, size);
+        size_t k = std::min(size, head_size - head_pos);
+        std::memcpy(buffer, head.data() + head_pos, k);
+        head_pos += k;
+        return k;
+    };
+
+    compression_format format = detect_compression(head.data(), head_size);
+    if ( format == COMPRESSION_NONE ) return parse_blocks(parser, input);
+
+    Decompression_Thread decompressor(format, input);
+    return parse_blocks(parser, [&decompressor](char *buffer, size_t size) {
+            return decompressor.read(buffer, size); });
+}
+
+template<typename Solver>
+bool parse_fd(Solver &solver, int fd) {
+    // a regular file is mapped in memory, and parsed without any copy
+    struct stat st;
+    if ( fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0 ) {
+        size_t length = static_cast<size_t>(st.st_size);
+        void *addr = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if ( addr != MAP_FAILED ) {
+            Memory_Map map(addr, length);
+            madvise(addr, length, MADV_SEQUENTIAL);
+            const char *begin = static_cast<const char*>(addr);
+
+            if ( detect_compression(begin, length) == COMPRESSION_NONE ) {
+                Parser<Solver> parser(solver);
+                bool conflict = parser.parse(begin, begin + length);
+                parser.finish();
+                return conflict;
             }
+
+            // compressed file, the decompressor read from the memory map
+            size_t pos = 0;
+            return parse_input(solver, [&](char *buffer, size_t size) {
+                    size_t k = std::min(size, length - pos);
+                    std::memcpy(buffer, begin + pos, k);
+                    pos += k;
+                    return k;
+                });
         }
     }
 
-    return false; // no conflict
+    // stdin, pipes or anything that can't be mapped are read in blocks
+    return parse_input(solver, [fd](char *buffer, size_t size) {
+            ssize_t n;
+            do { n = read(fd, buffer, size); } while ( n < 0 && errno == EINTR);
+            if ( n < 0 )
+                throw std::system_error(errno, std::generic_category(),
+                        "error reading the input");
+            return static_cast<size_t>(n);
+        });
+}
+
+template<typename Solver>
+bool parse_stream(Solver &solver, std::istream &is) {
+    return parse_input(solver, [&is](char *buffer, size_t size) {
+            is.read(buffer, static_cast<std::streamsize>(size));
+            return static_cast<size_t>(is.gcount());
+        });
 }
 
+template<typename Solver>
+bool parse_path(Solver &solver, const std::string &file_name) {
+    if ( file_name == "-" ) return parse_fd(solver, STDIN_FILENO);
+
+    File_Descriptor file(open(file_name.c_str(), O_RDONLY));
+    if ( file.fd < 0 )
+        throw std::system_error(errno, std::generic_category(),
+                "unable to open " + file_name);
+    return parse_fd(solver, file.fd);
+}
+
+} // end anonymous namespace
+
+bool Satyricon::parse_file(SATSolver& solver, std::istream & is)
+{
+    return parse_stream(solver, is);
+}
+
+bool Satyricon::parse_file(SATSolver& solver, const std::string &file_name)
+{
+    return parse_path(solver, file_name);
+}
+
+bool Satyricon::parse_file(PortfolioSolver& solver, std::istream & is)
+{
+    return parse_stream(solver, is);
+}
+
+bool Satyricon::parse_file(PortfolioSolver& solver,
+        const std::string &file_name)
+{
+    return parse_path(solver, file_name);
+}
+
+bool Satyricon::parse_file(CubeSolver& solver, std::istream & is)
+{
+    return parse_stream(solver, is);
+}
+
+bool Satyricon::parse_file(CubeSolver& solver, const std::string &file_name)
+{
+    return parse_path(solver, file_name);
+}
+
+bool Satyricon::parse_file(DRAT_Checker& checker, std::istream & is)
+{
+    return parse_stream(checker, is);
+}
+
+bool Satyricon::parse_file(DRAT_Checker& checker, const std::string &file_name)
+{
+    return parse_path(checker, file_name);
+}
+
+
+bool Satyricon::parse_file(CNF_Formula& formula, std::istream & is)
+{
+    return parse_stream(formula, is);
+}
+
+bool Satyricon::parse_file(CNF_Formula& formula, const std::string &file_name)
+{
+    return parse_path(formula, file_name);
+}
@@ -0,0 +1,434 @@
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <thread>
+#include "drat_checker.hpp"
+
+namespace Satyricon {
+
+const uint32_t DRAT_Checker::NEVER;
+
+struct DRAT_Checker::Worker {
+    // a watcher of the literal l is visited when l become false, the
+    // blocker is the other watched literal
+    struct Watch {
+        uint32_t clause;
+        Literal blocker;
+    };
+
+    explicit Worker(const DRAT_Checker &checker) :
+        horizon(NEVER), attached(0),
+        values(checker.number_of_variable, LIT_UNASIGNED),
+        reasons(checker.number_of_variable, NEVER), trail(),
+        watches(2 * checker.number_of_variable),
+        watched(checker.refs.size()),
+        seen(checker.number_of_variable, false)
+    {
+        for ( uint32_t i = 0; i < checker.refs.size(); ++i )
+            if ( checker.deleted[i] == NEVER ) attach(checker, i);
+    }
+
+    // the literals of a clause are shared, so the watched ones are kept by
+    // every worker
+    void attach(const DRAT_Checker &checker, uint32_t i) {
+        const Clause &c = checker.ca[checker.refs[i]];
+        if ( c.size() < 2 ) return;
+        watched[i] = {{ c[0], c[1] }};
+        watches[c[0].index()].push_back({ i, c[1] });
+        watches[c[1].index()].push_back({ i, c[0] });
+    }
+
+    literal_value value(Literal l) const {
+        if ( l.sign() )
+            return static_cast<literal_value>(LIT_TRUE - values[l.var()]);
+        return values[l.var()];
+    }
+
+    void assign(Literal l, uint32_t reason) {
+        values[l.var()] = l.sign() ? LIT_FALSE : LIT_TRUE;
+        reasons[l.var()] = reason;
+        trail.push_back(l);
+    }
+
+    void undo() {
+        for ( const auto & l : trail ) {
+            values[l.var()] = LIT_UNASIGNED;
+            reasons[l.var()] = NEVER;
+        }
+        trail.clear();
+    }
+
+    // the clauses added at this step or later are never active again, their
+    // watchers are dropped
+    uint32_t horizon;
+    // the first clauses of by_deletion are attached
+    size_t attached;
+
+    std::vector<literal_value> values;
+    std::vector<uint32_t> reasons;
+    std::vector<Literal> trail;
+    std::vector<std::vector<Watch> > watches;
+    std::vector<std::array<Literal, 2> > watched;
+    std::vector<bool> seen;
+};
+
+DRAT_Checker::DRAT_Checker(unsigned int t) :
+    ca(), refs(), added(), deleted(), units(), number_of_variable(0),
+    threads(t == 0 ? std::max(1u, std::thread::hardware_concurrency()) : t),
+    alive(), formula_clauses(0), steps(0), empty_clause(NEVER), marked(),
+    queue(), running(), mutex(), has_work(), busy(0), failed(false), core(0),
+    lemmas(0), checked(0), ignored(0), failure()
+{}
+
+DRAT_Checker::~DRAT_Checker() = default;
+
+void DRAT_Checker::set_number_of_variable(unsigned int n) {
+    number_of_variable = std::max(number_of_variable, n);
+}
+
+void DRAT_Checker::reserve_clauses(unsigned int n) {
+    refs.reserve(n);
+    added.reserve(n);
+    deleted.reserve(n);
+}
+
+bool DRAT_Checker::add_clause(std::vector<Literal> &c) {
+    new_clause(c, 0);
+    ++formula_clauses;
+    return false; // the conflicts are found by the check
+}
+
+uint64_t DRAT_Checker::clause_hash(const std::vector<Literal> &c) const {
+    uint64_t h = c.size();
+    for ( const auto & l : c )
+        h = (h ^ l.index()) * 0x100000001b3ull;
+    return h;
+}
+
+uint32_t DRAT_Checker::new_clause(std::vector<Literal> &c, uint32_t step) {
+    // sorted and without duplicates, to find the deleted clauses
+    std::sort(c.begin(), c.end(),
+            [](Literal a, Literal b) { return a.index() < b.index(); });
+    c.erase(std::unique(c.begin(), c.end()), c.end());
+    for ( const auto & l : c )
+        number_of_variable = std::max(number_of_variable, l.var() + 1);
+
+    uint32_t index = static_cast<uint32_t>(refs.size());
+    refs.push_back(ca.allocate(c));
+    added.push_back(step);
+    deleted.push_back(NEVER);
+    if ( c.size() == 1 ) units.push_back(index);
+    if ( c.empty() && empty_clause == NEVER ) empty_clause = index;
+    alive.insert({ clause_hash(c), index });
+    return index;
+}
+
+void DRAT_Checker::delete_clause(std::vector<Literal> &c, uint32_t step) {
+    std::sort(c.begin(), c.end(),
+            [](Literal a, Literal b) { return a.index() < b.index(); });
+    c.erase(std::unique(c.begin(), c.end()), c.end());
+
+    auto range = alive.equal_range(clause_hash(c));
+    for ( auto it = range.first; it != range.second; ++it ) {
+        const Clause &cl = ca[refs[it->second]];
+        if ( cl.size() != c.size() ||
+                ! std::equal(c.begin(), c.end(), cl.begin()) )
+            continue;
+        deleted[it->second] = step;
+        alive.erase(it);
+        return;
+    }
+    ++ignored;
+}
+
+void DRAT_Checker::read_proof(const std::string &file_name) {
+    std::ifstream in(file_name, std::ios::binary);
+    if ( ! in )
+        throw std::runtime_error("unable to open " + file_name);
+    std::vector<char> data((std::istreambuf_iterator<char>(in)),
+            std::istreambuf_iterator<char>());
+
+    // a binary proof start with 'a' or 'd', and has bytes that are not
+    // printable (the end of every clause is a 0)
+    bool binary = ! data.empty() && data[0] == 'a';
+    for ( size_t i = 0; i < std::min<size_t>(data.size(), 64); ++i ) {
+        unsigned char ch = static_cast<unsigned char>(data[i]);
+        if ( ch != '\n' && ch != '\r' && ch != '\t' && (ch < 32 || ch > 126) )
+            binary = true;
+    }
+
+    std::vector<Literal> lits;
+    size_t pos = 0, size = data.size();
+    auto end_of_step = [&](bool deletion) {
+        ++steps;
+        if ( deletion ) {
+            delete_clause(lits, steps);
+            return false;
+        }
+        ++lemmas;
+        new_clause(lits, steps);
+        // the lemmas after the empty clause are useless
+        return lits.empty();
+    };
+
+    while ( pos < size ) {
+        lits.clear();
+        if ( binary ) {
+            char kind = data[pos++];
+            if ( kind != 'a' && kind != 'd' )
+                throw std::runtime_error("malformed binary proof");
+            while ( true ) {
+                // groups of 7 bits, the last one without the high bit
+                uint64_t u = 0;
+                unsigned int shift = 0;
+                unsigned char ch;
+                do {
+                    if ( pos == size || shift > 28 )
+                        throw std::runtime_error("truncated binary proof");
+                    ch = static_cast<unsigned char>(data[pos++]);
+                    u |= uint64_t(ch & 127) << shift;
+                    shift += 7;
+                } while ( ch & 128 );
+                if ( u == 0 ) break;
+                if ( u < 2 )
+                    throw std::runtime_error("malformed binary proof");
+                lits.push_back(Literal::from_index(static_cast<int>(u - 2)));
+            }
+            if ( end_of_step(kind == 'd') ) return;
+            continue;
+        }
+
+        // textual format, a clause for each line
+        while ( pos < size && isspace(static_cast<unsigned char>(data[pos])) )
+            ++pos;
+        if ( pos == size ) break;
+        if ( data[pos] == 'c' ) {
+            while ( pos < size && data[pos] != '\n' ) ++pos;
+            continue;
+        }
+        bool deletion = data[pos] == 'd';
+        if ( deletion ) ++pos;
+        while ( true ) {
+            while ( pos < size && (data[pos] == ' ' || data[pos] == '\t') )
+                ++pos;
+            bool negative = pos < size && data[pos] == '-';
+            if ( negative ) ++pos;
+            if ( pos == size || ! isdigit(static_cast<unsigned char>(data[pos])) )
+                throw std::runtime_error("malformed proof");
+            long v = 0;
+            while ( pos < size && isdigit(static_cast<unsigned char>(data[pos])) )
+                v = v * 10 + (data[pos++] - '0');
+            if ( v == 0 ) break;
+            lits.push_back(Literal(static_cast<int>(v - 1), negative));
+        }
+        if ( end_of_step(deletion) ) return;
+    }
+}
+
+void DRAT_Checker::mark(uint32_t c) {
+    if ( marked[c].exchange(true, std::memory_order_relaxed) ) return;
+    if ( c < formula_clauses ) return;
+    std::lock_guard<std::mutex> lock(mutex);
+    queue.push_back(c);
+    std::push_heap(queue.begin(), queue.end());
+    has_work.notify_one();
+}
+
+bool DRAT_Checker::check() {
+    // without the empty clause, the last formula must be refuted
+    if ( empty_clause == NEVER ) {
+        std::vector<Literal> empty;
+        new_clause(empty, ++steps);
+    }
+
+    by_deletion.clear();
+    for ( uint32_t i = 0; i < refs.size(); ++i )
+        if ( deleted[i] != NEVER ) by_deletion.push_back(i);
+    std::sort(by_deletion.begin(), by_deletion.end(),
+            [this](uint32_t a, uint32_t b) { return deleted[a] > deleted[b]; });
+
+    marked.reset(new std::atomic<bool>[refs.size()]);
+    for ( size_t i = 0; i < refs.size(); ++i ) marked[i] = false;
+    queue.clear();
+    running.clear();
+    busy = 0;
+    failed = false;
+    checked = 0;
+    mark(empty_clause);
+
+    // every thread builds its own watch lists
+    std::vector<std::thread> workers;
+    for ( unsigned int i = 0; i < threads; ++i )
+        workers.emplace_back([this]() {
+                Worker w(*this);
+                worker_loop(w);
+            });
+    for ( auto & w : workers ) w.join();
+
+    core = 0;
+    for ( size_t i = 0; i < formula_clauses; ++i )
+        if ( marked[i] ) ++core;
+    return ! failed;
+}
+
+void DRAT_Checker::worker_loop(Worker &w) {
+    std::unique_lock<std::mutex> lock(mutex);
+    while ( true ) {
+        // the work is over when the queue is empty and nobody can mark
+        // other lemmas
+        has_work.wait(lock, [this]() {
+                return ! queue.empty() || busy == 0 || failed; });
+        if ( failed || queue.empty() ) {
+            has_work.notify_all();
+            return;
+        }
+        std::pop_heap(queue.begin(), queue.end());
+        uint32_t lemma = queue.back();
+        queue.pop_back();
+        ++busy;
+        running.push_back(lemma);
+        w.horizon = added[*std::max_element(running.begin(), running.end())];
+
+        lock.unlock();
+        bool correct = check_lemma(w, lemma);
+        lock.lock();
+
+        running.erase(std::find(running.begin(), running.end(), lemma));
+        --busy;
+        ++checked;
+        if ( ! correct && ! failed ) {
+            failed = true;
+            failure = "lemma " + std::to_string(lemma - formula_clauses + 1) +
+                " is not RUP: " + ca[refs[lemma]].print();
+        }
+        has_work.notify_all();
+    }
+}
+
+bool DRAT_Checker::check_lemma(Worker &w, uint32_t lemma) {
+    uint32_t step = added[lemma];
+    const Clause &c = ca[refs[lemma]];
+    uint32_t conflict = NEVER;
+
+    // the clauses deleted after this step can be active
+    for ( ; w.attached < by_deletion.size() &&
+            deleted[by_deletion[w.attached]] > step; ++w.attached )
+        if ( added[by_deletion[w.attached]] < w.horizon )
+            w.attach(*this, by_deletion[w.attached]);
+
+    // the negation of the lemma
+    for ( const auto & l : c ) {
+        if ( w.value(l) == LIT_TRUE ) {
+            w.undo();
+            return true; // a tautology
+        }
+        w.assign(!l, NEVER);
+    }
+
+    // the units are not watched
+    for ( const auto & u : units ) {
+        if ( ! is_active(u, step) ) continue;
+        Literal l = ca[refs[u]][0];
+        if ( w.value(l) == LIT_TRUE ) continue;
+        if ( w.value(l) == LIT_FALSE ) {
+            conflict = u;
+            break;
+        }
+        w.assign(l, u);
+    }
+    if ( conflict == NEVER ) conflict = propagate(w, step);
+    if ( conflict == NEVER ) {
+        w.undo();
+        return false;
+    }
+
+    // the clauses in the implication graph of the conflict are in the proof
+    mark(conflict);
+    for ( const auto & l : ca[refs[conflict]] ) w.seen[l.var()] = true;
+    for ( size_t i = w.trail.size(); i-- > 0; ) {
+        var v = static_cast<var>(w.trail[i].var());
+        if ( ! w.seen[v] ) continue;
+        w.seen[v] = false;
+        uint32_t r = w.reasons[v];
+        if ( r == NEVER ) continue;
+        mark(r);
+        for ( const auto & l : ca[refs[r]] ) w.seen[l.var()] = true;
+    }
+    w.undo();
+    return true;
+}
+
+uint32_t DRAT_Checker::propagate(Worker &w, uint32_t step) {
+    // a literal is propagated with the marked clauses as soon as it is
+    // assigned, and with all the clauses only when the marked ones have
+    // nothing more to say
+    size_t core_head = 0, all_head = 0;
+    while ( true ) {
+        uint32_t conflict;
+        if ( core_head < w.trail.size() )
+            conflict = propagate_literal(w, w.trail[core_head++], step, true);
+        else if ( all_head < w.trail.size() )
+            conflict = propagate_literal(w, w.trail[all_head++], step, false);
+        else
+            return NEVER;
+        if ( conflict != NEVER ) return conflict;
+    }
+}
+
+uint32_t DRAT_Checker::propagate_literal(Worker &w, Literal p, uint32_t step,
+        bool core_only) {
+    Literal failed_literal = !p;
+    auto &ws = w.watches[failed_literal.index()];
+    size_t i = 0, j = 0;
+    for ( ; i < ws.size(); ++i ) {
+        Worker::Watch watch = ws[i];
+        if ( added[watch.clause] >= w.horizon ) continue;
+        // a clause marked by another thread during the propagation is
+        // visited again with all the clauses, so a relaxed read is enough
+        if ( (core_only &&
+                    ! marked[watch.clause].load(std::memory_order_relaxed)) ||
+                ! is_active(watch.clause, step) ||
+                w.value(watch.blocker) == LIT_TRUE ) {
+            ws[j++] = watch;
+            continue;
+        }
+
+        // the false literal is the second watched one
+        auto &pair = w.watched[watch.clause];
+        if ( pair[0] == failed_literal ) std::swap(pair[0], pair[1]);
+        Literal other = pair[0];
+        watch.blocker = other;
+        if ( w.value(other) == LIT_TRUE ) {
+            ws[j++] = watch;
+            continue;
+        }
+
+        // search a new literal to watch
+        bool moved = false;
+        for ( const auto & l : ca[refs[watch.clause]] ) {
+            if ( l == other || l == failed_literal ||
+                    w.value(l) == LIT_FALSE )
+                continue;
+            pair[1] = l;
+            w.watches[l.index()].push_back(watch);
+            moved = true;
+            break;
+        }
+        if ( moved ) continue;
+
+        ws[j++] = watch;
+        if ( w.value(other) == LIT_FALSE ) {
+            // conflict, keep the other watchers
+            for ( ++i; i < ws.size(); ++i ) ws[j++] = ws[i];
+            ws.resize(j);
+            return watch.clause;
+        }
+        w.assign(other, watch.clause);
+    }
+    ws.resize(j);
+    return NEVER;
+}
+
+} // end namespace Satyricon
@@ -0,0 +1,122 @@
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+#include "ipasir.h"
+#include "sat_solver.hpp"
+
+using Satyricon::Literal;
+using Satyricon::SATSolver;
+
+namespace {
+
+/**
+ * State of an IPASIR solver: the clause under construction and the
+ * assumptions for the next solve
+ */
+struct IPASIR_Solver {
+    IPASIR_Solver() : solver(), clause(), assumptions(), learned() {
+        solver.set_log(0);
+    }
+
+    // convert a DIMACS literal, creating its variable if needed
+    Literal literal(int lit) {
+        unsigned int var = static_cast<unsigned int>(std::abs(lit));
+        if ( var > solver.get_number_of_variable() )
+            solver.set_number_of_variable(var);
+        return Literal(static_cast<int>(var) - 1, lit < 0);
+    }
+
+    SATSolver solver;
+    std::vector<Literal> clause;
+    std::vector<Literal> assumptions;
+    std::vector<int> learned; // buffer for the learn callback
+};
+
+inline IPASIR_Solver &get(void *s) {
+    return *static_cast<IPASIR_Solver*>(s);
+}
+
+inline int to_dimacs(Literal l) {
+    int var = static_cast<int>(l.var()) + 1;
+    return l.sign() ? -var : var;
+}
+
+} // end anonymous namespace
+
+const char * ipasir_signature () {
+    return "satyricon-1.0";
+}
+
+void * ipasir_init () {
+    return new IPASIR_Solver();
+}
+
+void ipasir_release (void * solver) {
+    delete static_cast<IPASIR_Solver*>(solver);
+}
+
+void ipasir_add (void * solver, int lit_or_zero) {
+    IPASIR_Solver &s = get(solver);
+    if ( lit_or_zero != 0 ) {
+        s.clause.push_back(s.literal(lit_or_zero));
+        return;
+    }
+    // an empty or conflicting clause make the solver unsatisfiable forever
+    s.solver.add_clause(s.clause);
+    s.clause.clear();
+}
+
+void ipasir_assume (void * solver, int lit) {
+    IPASIR_Solver &s = get(solver);
+    s.assumptions.push_back(s.literal(lit));
+}
+
+int ipasir_solve (void * solver) {
+    IPASIR_Solver &s = get(solver);
+    bool satisfiable = s.solver.solve(s.assumptions);
+    s.assumptions.clear();
+    if ( s.solver.interrupted() ) return 0;
+    return satisfiable ? 10 : 20;
+}
+
+int ipasir_val (void * solver, int lit) {
+    const std::vector<int> &model = get(solver).solver.get_model();
+    size_t var = static_cast<size_t>(std::abs(lit));
+    // a variable created after the last solve is unconstrained
+    if ( var > model.size() ) return lit;
+    return ( model[var-1] > 0 ) == ( lit > 0 ) ? lit : -lit;
+}
+
+int ipasir_failed (void * solver, int lit) {
+    const std::vector<Literal> &failed =
+        get(solver).solver.get_failed_assumptions();
+    Literal l(std::abs(lit) - 1, lit < 0);
+    return std::find(failed.begin(), failed.end(), l) != failed.end();
+}
+
+void ipasir_set_terminate (void * solver, void * data,
+        int (*terminate)(void * data)) {
+    if ( terminate == nullptr ) {
+        get(solver).solver.set_terminate(nullptr);
+        return;
+    }
+    get(solver).solver.set_terminate([data, terminate]() {
+            return terminate(data) != 0; });
+}
+
+void ipasir_set_learn (void * solver, void * data, int max_length,
+        void (*learn)(void * data, int * clause)) {
+    IPASIR_Solver &s = get(solver);
+    if ( learn == nullptr || max_length < 0 ) {
+        s.solver.set_learn(0, nullptr);
+        return;
+    }
+    s.solver.set_learn(static_cast<unsigned int>(max_length),
+            [&s, data, learn](const std::vector<Literal> &clause) {
+                s.learned.clear();
+                for ( const auto & l : clause )
+                    s.learned.push_back(to_dimacs(l));
+                s.learned.push_back(0);
+                learn(data, s.learned.data());
+            });
+}
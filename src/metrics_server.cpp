@@ -0,0 +1,160 @@
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "metrics_server.hpp"
+
+namespace Satyricon {
+
+namespace {
+
+std::runtime_error socket_error(const std::string &what) {
+    return std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+// a request is read up to the empty line, or until the client stops
+// sending for a while
+void read_request(int client) {
+    std::string request;
+    char buffer[1024];
+    while ( request.find("\r\n\r\n") == std::string::npos &&
+            request.size() < 8192 ) {
+        pollfd p{client, POLLIN, 0};
+        if ( poll(&p, 1, 1000) <= 0 ) return;
+        ssize_t n = read(client, buffer, sizeof(buffer));
+        if ( n <= 0 ) return;
+        request.append(buffer, static_cast<size_t>(n));
+    }
+}
+
+void write_all(int fd, const std::string &s) {
+    size_t done = 0;
+    while ( done < s.size() ) {
+        ssize_t n = send(fd, s.data() + done, s.size() - done, MSG_NOSIGNAL);
+        if ( n <= 0 ) return; // the client is gone
+        done += static_cast<size_t>(n);
+    }
+}
+
+} // end anonymous namespace
+
+Metrics_Server::Metrics_Server(const std::string &address) :
+    listen_fd(-1), wake_fd{-1,-1}, socket_path(), mutex(), latest(),
+    server()
+{
+    const std::string unix_prefix = "unix:";
+    if ( address.compare(0, unix_prefix.size(), unix_prefix) == 0 ) {
+        socket_path = address.substr(unix_prefix.size());
+        sockaddr_un a{};
+        if ( socket_path.empty() || socket_path.size() >= sizeof(a.sun_path) )
+            throw std::runtime_error("invalid socket path " + socket_path);
+        a.sun_family = AF_UNIX;
+        std::strcpy(a.sun_path, socket_path.c_str());
+        listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if ( listen_fd < 0 ) throw socket_error("socket");
+        unlink(socket_path.c_str()); // a socket left by a previous run
+        if ( bind(listen_fd, reinterpret_cast<sockaddr*>(&a), sizeof(a)) ) {
+            close(listen_fd);
+            throw socket_error("can't bind " + socket_path);
+        }
+    }
+    else {
+        unsigned long port = 0;
+        size_t end = 0;
+        try { port = std::stoul(address, &end); }
+        catch (const std::exception&) { end = 0; }
+        if ( end != address.size() || port == 0 || port > 65535 )
+            throw std::runtime_error("invalid metrics address " + address);
+        sockaddr_in a{};
+        a.sin_family = AF_INET;
+        a.sin_port = htons(static_cast<uint16_t>(port));
+        a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+        if ( listen_fd < 0 ) throw socket_error("socket");
+        int on = 1;
+        setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        if ( bind(listen_fd, reinterpret_cast<sockaddr*>(&a), sizeof(a)) ) {
+            close(listen_fd);
+            throw socket_error("can't bind port " + address);
+        }
+    }
+
+    if ( listen(listen_fd, 8) != 0 || pipe(wake_fd) != 0 ) {
+        close(listen_fd);
+        throw socket_error("can't listen on " + address);
+    }
+    server = std::thread([this]() { serve_loop(); });
+}
+
+Metrics_Server::~Metrics_Server() {
+    char c = 0;
+    ssize_t n = write(wake_fd[1], &c, 1);
+    (void)n; // the pipe is never full
+    server.join();
+    close(listen_fd);
+    close(wake_fd[0]);
+    close(wake_fd[1]);
+    if ( ! socket_path.empty() ) unlink(socket_path.c_str());
+}
+
+void Metrics_Server::publish(unsigned int solver, const SolverStats &s) {
+    std::lock_guard<std::mutex> lock(mutex);
+    latest[solver] = s;
+}
+
+std::string Metrics_Server::metrics() {
+    std::map<unsigned int, SolverStats> copy;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        copy = latest;
+    }
+
+    // the counters have the _total suffix, as required by the format
+    std::ostringstream out;
+    for ( const auto &f : stats_fields() ) {
+        std::string name = std::string("satyricon_") + f.name +
+            (f.counter ? "_total" : "");
+        out << "# HELP " << name << " " << f.help << "\n";
+        out << "# TYPE " << name << (f.counter ? " counter\n" : " gauge\n");
+        for ( const auto &s : copy )
+            out << name << "{solver=\"" << s.first << "\"} " <<
+                s.second.*f.value << "\n";
+    }
+    return out.str();
+}
+
+void Metrics_Server::serve_loop() {
+    while ( true ) {
+        pollfd p[2] = { {listen_fd, POLLIN, 0}, {wake_fd[0], POLLIN, 0} };
+        if ( poll(p, 2, -1) < 0 ) {
+            if ( errno == EINTR ) continue;
+            return;
+        }
+        if ( p[1].revents != 0 ) return; // closing
+        if ( p[0].revents == 0 ) continue;
+
+        int client = accept(listen_fd, nullptr, nullptr);
+        if ( client < 0 ) continue;
+        answer(client);
+        close(client);
+    }
+}
+
+void Metrics_Server::answer(int client) {
+    read_request(client);
+    std::string body = metrics();
+    std::ostringstream response;
+    response << "HTTP/1.0 200 OK\r\n"
+        "Content-Type: text/plain; version=0.0.4\r\n"
+        "Content-Length: " << body.size() << "\r\n"
+        "Connection: close\r\n\r\n" << body;
+    write_all(client, response.str());
+}
+
+} // end namespace Satyricon
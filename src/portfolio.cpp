@@ -0,0 +1,126 @@
+#include <thread>
+#include "portfolio.hpp"
+
+namespace Satyricon {
+
+PortfolioSolver::PortfolioSolver(unsigned int number_of_solvers) :
+    solvers(), exchange(), clause_copy(), stop(false), winner(0)
+{
+    assert( number_of_solvers > 0 );
+    for ( unsigned int i = 0; i < number_of_solvers; ++i ) {
+        solvers.emplace_back(new SATSolver());
+        solvers.back()->set_interrupt(&stop);
+        // the other threads are busy with the other solvers
+        if ( number_of_solvers > 1 )
+            solvers.back()->set_preprocessing_threads(1);
+    }
+    set_clause_sharing(true);
+}
+
+void PortfolioSolver::set_clause_sharing(bool s) {
+    // a single solver has nobody to share with
+    if ( s && solvers.size() > 1 ) {
+        exchange.reset(new Clause_Exchange());
+        for ( size_t i = 0; i < solvers.size(); ++i )
+            solvers[i]->set_clause_exchange(exchange.get(),
+                    static_cast<unsigned int>(i));
+    }
+    else {
+        for ( auto & solver : solvers )
+            solver->set_clause_exchange(nullptr, 0);
+        exchange.reset();
+    }
+}
+
+uint64_t PortfolioSolver::get_exchanged_clauses() const {
+    return exchange ? exchange->published() : 0;
+}
+
+uint64_t PortfolioSolver::get_imported_clauses() const {
+    uint64_t imported = 0;
+    for ( const auto & solver : solvers )
+        imported += solver->get_imported_clauses();
+    return imported;
+}
+
+void PortfolioSolver::set_number_of_variable(unsigned int n) {
+    for ( auto & s : solvers ) s->set_number_of_variable(n);
+}
+
+void PortfolioSolver::reserve_clauses(unsigned int n) {
+    for ( auto & s : solvers ) s->reserve_clauses(n);
+}
+
+bool PortfolioSolver::add_clause(std::vector<Literal>& c) {
+    // a solver simplify the clause in place, so every solver get a copy.
+    // all the solvers have the same problem, so they all find the conflict
+    bool conflict = false;
+    for ( auto & s : solvers ) {
+        clause_copy = c;
+        conflict = s->add_clause(clause_copy);
+    }
+    return conflict;
+}
+
+void PortfolioSolver::diversify() {
+    // the first solver keep its parameters, the others cycle through a set
+    // of different restart, decay and polarity settings
+    static const unsigned int restart_multiplier[] = { 100, 50, 200, 150, 75 };
+    static const double literal_decay[] = { 0.95, 0.90, 0.99, 0.85, 0.97 };
+    static const double clause_decay[]  = { 0.999, 0.99, 0.9999, 0.995 };
+    static const polarity_mode polarity[] = { POLARITY_SAVED,
+        POLARITY_NEGATIVE, POLARITY_POSITIVE, POLARITY_SAVED,
+        POLARITY_RANDOM };
+    static const restart_mode restart_policy[] = { RESTART_STABLE,
+        RESTART_GLUCOSE, RESTART_LUBY };
+
+    for ( size_t i = 1; i < solvers.size(); ++i ) {
+        SATSolver &s = *solvers[i];
+        s.set_restart_policy(restart_policy[i % 3]);
+        s.set_restarting_multiplier(restart_multiplier[i % 5]);
+        s.set_literal_decay(literal_decay[i % 5]);
+        s.set_clause_decay(clause_decay[i % 4]);
+        s.set_polarity(polarity[i % 5]);
+        s.set_random_seed(static_cast<uint32_t>(i));
+        s.set_log(0);
+    }
+}
+
+bool PortfolioSolver::solve() {
+    stop = false;
+
+    // a single solver run on the current thread
+    if ( solvers.size() == 1 ) {
+        winner = 0;
+        return solvers[0]->solve();
+    }
+
+    std::vector<char> results(solvers.size(), false);
+    std::atomic<bool> found(false);
+    std::vector<std::thread> threads;
+    for ( size_t i = 0; i < solvers.size(); ++i ) {
+        threads.emplace_back([this, i, &results, &found]() {
+            results[i] = solvers[i]->solve();
+            // the first definitive answer stop the others
+            bool expected = false;
+            if ( ! solvers[i]->interrupted() &&
+                    found.compare_exchange_strong(expected, true) ) {
+                winner = i;
+                stop = true;
+            }
+        });
+    }
+    for ( auto & t : threads ) t.join();
+
+    return results[winner];
+}
+
+const std::vector<int>& PortfolioSolver::get_model() {
+    return solvers[winner]->get_model();
+}
+
+std::string PortfolioSolver::string_model() {
+    return solvers[winner]->string_model();
+}
+
+} // end namespace Satyricon
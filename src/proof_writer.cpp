@@ -0,0 +1,133 @@
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include "proof_writer.hpp"
+
+namespace Satyricon {
+
+Proof_Writer::Proof_Writer(const std::string &file_name, bool b) :
+    file(std::fopen(file_name.c_str(), b ? "wb" : "w")), binary(b),
+    added(0), deleted(0), buffer(), pending(), mutex(), has_pending(),
+    written(), closing(false), error(0), writer()
+{
+    if ( file == nullptr )
+        throw std::runtime_error("can't open the proof file " + file_name);
+    buffer.reserve(buffer_size + 64);
+    pending.reserve(buffer_size + 64);
+    writer = std::thread([this]() { writer_loop(); });
+}
+
+Proof_Writer::~Proof_Writer() {
+    stop();
+}
+
+void Proof_Writer::close() {
+    stop();
+    check_error();
+}
+
+void Proof_Writer::stop() {
+    if ( file == nullptr ) return; // already closed
+    drain();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        closing = true;
+    }
+    has_pending.notify_one();
+    writer.join();
+    if ( std::fclose(file) != 0 && error == 0 ) error = errno;
+    file = nullptr;
+}
+
+void Proof_Writer::check_error() const {
+    if ( error != 0 )
+        throw std::runtime_error(std::string("can't write the proof: ") +
+                std::strerror(error));
+}
+
+void Proof_Writer::start_line(char kind) {
+    if ( binary ) buffer.push_back(kind);
+    else if ( kind == 'd' ) {
+        buffer.push_back('d');
+        buffer.push_back(' ');
+    }
+}
+
+void Proof_Writer::write_literal(Literal l) {
+    if ( binary ) {
+        // the DIMACS literal x is 2|x| + (x < 0), in groups of 7 bits with
+        // the high bit set on all the groups but the last
+        unsigned int u = l.index() + 2;
+        while ( u > 127 ) {
+            buffer.push_back(static_cast<char>((u & 127) | 128));
+            u >>= 7;
+        }
+        buffer.push_back(static_cast<char>(u));
+        return;
+    }
+
+    char digits[16];
+    int n = 0;
+    unsigned int v = l.var() + 1;
+    do {
+        digits[n++] = static_cast<char>('0' + v % 10);
+        v /= 10;
+    } while ( v != 0 );
+    if ( l.sign() ) buffer.push_back('-');
+    while ( n > 0 ) buffer.push_back(digits[--n]);
+    buffer.push_back(' ');
+}
+
+void Proof_Writer::end_line() {
+    if ( binary ) buffer.push_back(0);
+    else {
+        buffer.push_back('0');
+        buffer.push_back('\n');
+    }
+    if ( buffer.size() >= buffer_size ) hand_over();
+}
+
+void Proof_Writer::hand_over() {
+    std::unique_lock<std::mutex> lock(mutex);
+    // the previous buffer must be written before the swap
+    written.wait(lock, [this]() { return pending.empty(); });
+    pending.swap(buffer);
+    lock.unlock();
+    has_pending.notify_one();
+}
+
+void Proof_Writer::drain() {
+    if ( ! buffer.empty() ) hand_over();
+    std::unique_lock<std::mutex> lock(mutex);
+    written.wait(lock, [this]() { return pending.empty(); });
+    if ( error == 0 && std::fflush(file) != 0 ) error = errno;
+}
+
+void Proof_Writer::flush() {
+    if ( file == nullptr ) throw std::runtime_error("the proof is closed");
+    drain();
+    check_error();
+}
+
+void Proof_Writer::writer_loop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while ( true ) {
+        has_pending.wait(lock, [this]() {
+                return ! pending.empty() || closing; });
+        if ( pending.empty() ) return; // closing
+
+        // the solver doesn't touch the pending buffer until it is empty
+        lock.unlock();
+        int failure = 0;
+        if ( error == 0 &&
+                std::fwrite(pending.data(), 1, pending.size(), file) !=
+                pending.size() )
+            failure = errno != 0 ? errno : EIO;
+        lock.lock();
+        if ( failure != 0 ) error = failure;
+        pending.clear();
+        written.notify_all();
+    }
+}
+
+} // end namespace Satyricon
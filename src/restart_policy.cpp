@@ -0,0 +1,152 @@
+#include "restart_policy.hpp"
+
+namespace Satyricon {
+
+unsigned int luby(unsigned int i) {
+    // the code is based on minisat
+    unsigned int size, seq;
+
+    // find in what sequence we are, the sequence i have lenght (2^i)-1
+    for ( size = 1, seq = 0; size < i+1; ++seq, size = 2*size + 1 )
+        ;
+
+    // find the value inside the sequence
+    while ( (size-1) != i ) {
+        size /= 2;
+        --seq;
+        i %= size; // NOLINT(clang-analyzer-core.DivideZero)
+    }
+
+    return 1 << seq; // 2^seq
+}
+
+namespace {
+
+/**
+ * Restart after a number of conflicts given by the luby sequence
+ */
+class Luby_Restart final : public Restart_Policy {
+public:
+    explicit Luby_Restart(unsigned int m) :
+        multiplier(m), index(0), conflicts(0), threshold(m * luby(0)) {}
+
+    void conflict(unsigned int, size_t) override { ++conflicts; }
+    bool should_restart() override { return conflicts >= threshold; }
+    void restart() override {
+        threshold = conflicts + uint64_t(multiplier) * luby(++index);
+    }
+    bool stable() const override { return true; }
+    const char *name() const override { return "luby"; }
+
+private:
+    unsigned int multiplier;
+    unsigned int index;
+    uint64_t conflicts, threshold;
+};
+
+/**
+ * Glucose restarts: restart when the glue of the recent learned clauses
+ * (fast average) is worse than the glue of the whole search (slow average).
+ * A restart is blocked when the trail is much longer than usual, because
+ * the solver may be close to a model.
+ */
+class Glucose_Restart final : public Restart_Policy {
+public:
+    Glucose_Restart() : fast(1.0/32), slow(1.0/16384), trail_average(1.0/4096),
+        conflicts(0), since_restart(0) {}
+
+    void conflict(unsigned int glue, size_t trail) override {
+        ++conflicts;
+        ++since_restart;
+        if ( conflicts > blocking_start &&
+                trail > blocking_margin * trail_average.value() )
+            since_restart = 0; // postpone the restart
+        fast.update(glue);
+        slow.update(glue);
+        trail_average.update(static_cast<double>(trail));
+    }
+
+    bool should_restart() override {
+        return since_restart >= minimum_interval &&
+            fast.value() > restart_margin * slow.value();
+    }
+
+    void restart() override { since_restart = 0; }
+    bool stable() const override { return false; }
+    const char *name() const override { return "glucose"; }
+
+private:
+    static constexpr double restart_margin = 1.25;
+    static constexpr double blocking_margin = 1.4;
+    static const uint64_t blocking_start = 10000;
+    static const uint64_t minimum_interval = 50;
+
+    Moving_Average fast, slow, trail_average;
+    uint64_t conflicts, since_restart;
+};
+
+/**
+ * Alternate a focused phase, with glucose restarts, and a stable phase,
+ * with reluctant doubling (luby) restarts. The phases are measured in
+ * conflicts, and their length is doubled after every stable phase.
+ */
+class Stable_Restart final : public Restart_Policy {
+public:
+    Stable_Restart() : focused(), reluctant(1024), stable_phase(false),
+        switch_pending(false), conflicts(0), phase_length(1000),
+        next_switch(1000) {}
+
+    void conflict(unsigned int glue, size_t trail) override {
+        active().conflict(glue, trail);
+        if ( ++conflicts < next_switch ) return;
+
+        // a new phase start with a restart
+        if ( stable_phase ) phase_length *= 2;
+        stable_phase = ! stable_phase;
+        switch_pending = true;
+        next_switch = conflicts + phase_length;
+    }
+
+    bool should_restart() override {
+        return switch_pending || active().should_restart();
+    }
+
+    void restart() override {
+        switch_pending = false;
+        active().restart();
+    }
+
+    bool stable() const override { return stable_phase; }
+    const char *name() const override {
+        return stable_phase ? "stable" : "focused";
+    }
+
+private:
+    Restart_Policy &active() {
+        if ( stable_phase ) return reluctant;
+        return focused;
+    }
+
+    Glucose_Restart focused;
+    Luby_Restart reluctant;
+    bool stable_phase;
+    bool switch_pending;
+    uint64_t conflicts, phase_length, next_switch;
+};
+
+} // end anonymous namespace
+
+std::unique_ptr<Restart_Policy> make_restart_policy(restart_mode mode,
+        unsigned int luby_multiplier) {
+    switch ( mode ) {
+        case RESTART_GLUCOSE:
+            return std::unique_ptr<Restart_Policy>(new Glucose_Restart());
+        case RESTART_STABLE:
+            return std::unique_ptr<Restart_Policy>(new Stable_Restart());
+        default:
+            return std::unique_ptr<Restart_Policy>(
+                    new Luby_Restart(luby_multiplier));
+    }
+}
+
+} // end namespace Satyricon
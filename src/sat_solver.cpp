@@ -3,6 +3,7 @@
 #include <algorithm>
 #include <tuple>
 #include <iomanip>
+#include <thread>
 #include "sat_solver.hpp"
 
 using std::endl; using std::setw; using std::max;
@@ -29,75 +30,167 @@ if ( log_level >= 1 ) {            \
 
 // defualt constructor
 SATSolver::SATSolver():
+    ca(),
     clauses(),
     learned(),
+    local_learned(0),
     number_of_variable(0),
+    number_of_binary_clauses(0),
+    preprocessed(false),
+    eliminated(),
+    number_of_eliminated(0),
+    extension(),
     watch_list(),
+    binary_watch_list(),
     values(),
     decision_levels(),
     antecedents(),
     propagation_starting_pos(0),
+    binary_propagation_pos(0),
+    stats(),
+    progress_callback(),
+    progress_interval(0),
+    last_progress(),
+    simplified_assigned(0),
+    next_simplify(0),
     trail(),
     trail_limit(),
     log_level(1),
     model(),
+    restarts(),
     solve_conflict_literals(),
     propagation_to_move(),
+    binary_conflict(),
     analisys_seen(),
-    analisys_reason(),
-    literals_activity(),
-    order(literals_activity,values),
+    analisys_clear(),
+    analisys_stack(),
+    variables_activity(),
+    order(variables_activity,values),
+    saved_phase(),
+    occurrence_balance(),
+    target_phase(),
+    best_phase(),
+    target_assigned(0),
+    best_assigned(0),
+    rephase_count(0),
     seed_1(123456789),
     seed_2(362436000),
     seed_3(521288629),
     seed_4(7654321),
+    interrupt_flag(nullptr),
+    search_interrupted(false),
+    root_conflict(false),
+    failed_assumptions(),
+    terminate_callback(),
+    learn_callback(),
+    learn_callback_size(0),
+    exchange(nullptr),
+    exchange_id(0),
+    exchange_cursor(0),
+    export_budget(0.0),
+    exported_clauses(0),
+    imported_clauses(0),
+    lbd_seen(),
+    lbd_stamp(0),
+    proof(nullptr),
+    proof_clause(),
+    proof_units(0),
     param()
 {}
 
-SATSolver::~SATSolver() {
-    for ( auto &c : clauses ) remove_clause(c);
-    for ( auto &c : learned ) remove_clause(c);
-}
+// all the clauses live inside the arena, that is released with the solver
+SATSolver::~SATSolver() {}
 
 bool SATSolver::solve() {
+    return solve(vector<Literal>());
+}
+
+bool SATSolver::solve(const vector<Literal> &assumptions) {
     // main method
     PRINT("begin solve" << endl);
 
+    // a previous call can leave the assignment of its model
+    if ( current_level() > 0 ) cancel_until(0);
+    failed_assumptions.clear();
+    search_interrupted = false;
+    if ( root_conflict ) return false; // UNSAT
+
+    // an assumption can be on a variable never declared, it is free
+    for ( const auto & p : assumptions )
+        if ( p.var() >= number_of_variable )
+            set_number_of_variable(p.var() + 1);
+
+    // an assumption on an eliminated variable require its clauses
+    for ( const auto & p : assumptions )
+        if ( eliminated[p.var()] ) {
+            if ( restore_eliminated() ) return false; // UNSAT
+            break;
+        }
+
     // initialize search parameter
     unsigned int conflict_counter = 0;
     unsigned int restart_counter = 0;
-    unsigned int learn_limit = static_cast<unsigned int>(
-            static_cast<double>(clauses.size())*param.initial_learn_mult );
-    param.restart_threshold = new_restart_threshold();
+    unsigned int learn_limit = static_cast<unsigned int>( static_cast<double>(
+            clauses.size() + number_of_binary_clauses)*param.initial_learn_mult );
+    restarts = make_restart_policy(param.restart_policy,
+            param.restart_interval_multiplier);
+
+    unsigned int next_rephase = param.rephase_interval;
+    unsigned int next_vivification = param.vivification_interval;
+    uint64_t search_propagations = stats.propagations;
 
     unsigned int increase_limit_threshold = 100;
     unsigned int increase_limit_counter = increase_limit_threshold;
 
-    // order literal for decision
-    order.initialize_heap();
+    search_interrupted = false;
 
     // preprocess
-    if ( param.enable_preprocessing) { preprocessing(); }
+    if ( param.enable_preprocessing && preprocessing(assumptions) ) {
+        PRINT_VERBOSE("conflict in preprocessing" << endl);
+        set_root_conflict();
+        return false; // UNSAT
+    }
+
+    // order variables for decision
+    order.initialize_heap();
 
     print_status(conflict_counter,restart_counter, learn_limit);
     while ( true ) { // loop until a solution is found
 
+        // stop if requested from outside
+        if ( interrupt_flag != nullptr &&
+                interrupt_flag->load(std::memory_order_relaxed) ) {
+            PRINT_VERBOSE("search interrupted" << endl);
+            search_interrupted = true;
+            cancel_until(0);
+            return false; // UNKNOWN
+        }
+
         PRINT_VERBOSE("propagate at level " << current_level() << endl);
         // propagate assingment effect
-        ClausePtr conflict = propagation();
+        Antecedent conflict = propagation();
 
-        if ( conflict != nullptr ) {
+        if ( ! conflict.is_undef() ) {
 
             conflict_counter++;
+            stats.conflicts++;
 
             // if a conflict is found on level 0, it is impossible to solve
             // so the formula must be unsatisfiable
             if ( current_level() == 0 ) {
                 PRINT_VERBOSE("conflict at level 0, build unsat proof" << endl);
                 print_status(conflict_counter,restart_counter, learn_limit);
+                set_root_conflict();
                 return false; // UNSAT
             }
 
+            if ( terminate_callback && terminate_callback() ) {
+                PRINT_VERBOSE("search terminated" << endl);
+                search_interrupted = true;
+                cancel_until(0);
+                return false; // UNKNOWN
+            }
+
             if ( --increase_limit_counter == 0 ) {
                 increase_limit_threshold *= 1.5;
                 increase_limit_counter = increase_limit_threshold;
@@ -108,54 +201,134 @@ bool SATSolver::solve() {
             }
             // otherwise, analize the conflict and backtrack
 
+            if ( param.enable_target_phase || param.enable_rephase )
+                update_target_phase();
+
+            size_t conflict_trail = trail.size();
             int backtrack_level;
             solve_conflict_literals.clear();
             conflict_analysis(conflict,solve_conflict_literals,backtrack_level);
 
+            // the asserting literal is unassigned by the analysis, and it is
+            // the only one at the conflict level
+            unsigned int glue = compute_lbd(solve_conflict_literals) + 1;
+            restarts->conflict(glue, conflict_trail);
+
             cancel_until( backtrack_level );
-            learn_clause(solve_conflict_literals); // learn the conflcit clause
+            // learn the conflcit clause
+            learn_clause(solve_conflict_literals, glue);
+            if ( exchange != nullptr )
+                export_clause(solve_conflict_literals, glue);
+            if ( learn_callback &&
+                    solve_conflict_literals.size() <= learn_callback_size )
+                learn_callback(solve_conflict_literals);
 
             // after a conflict, the activity of literals and clauses decay
-            literals_activity_decay();
+            variables_activity_decay();
             clause_activity_decay();
+
+            // the rephasing interval grows arithmetically
+            if ( param.enable_rephase && conflict_counter >= next_rephase ) {
+                rephase();
+                next_rephase = conflict_counter +
+                    param.rephase_interval * (rephase_count + 1);
+            }
         }
         else {
             // no conflict and no more value to propagate
 
+            // the permanent assignments simplify the clauses, at most once
+            // for each pass over the clause database
+            if ( current_level() == 0 && trail.size() > simplified_assigned &&
+                    stats.propagations >= next_simplify )
+                simplify_database();
+
+            // the assumptions are decided first, one for each level
+            size_t level = static_cast<size_t>(current_level());
+            if ( level < assumptions.size() ) {
+                Literal p = assumptions[level];
+                literal_value v = get_asigned_value(p);
+                if ( v == LIT_FALSE ) {
+                    PRINT_VERBOSE("assumption " << p << " is false" << endl);
+                    print_status(conflict_counter,restart_counter, learn_limit);
+                    analyze_final(p);
+                    cancel_until(0);
+                    return false; // UNSAT under the assumptions
+                }
+                if ( v == LIT_TRUE ) {
+                    // already implied, open an empty level
+                    trail_limit.push_back(static_cast<int>(trail.size()));
+                    continue;
+                }
+                PRINT_VERBOSE("assume literal " << p << endl);
+                assume(p);
+                continue;
+            }
+
             // if all variables are asigned, the problem is satisfiable
-            if ( number_of_assigned_variable() == number_of_variable ) {
+            if ( number_of_assigned_variable() + number_of_eliminated ==
+                    number_of_variable ) {
                 PRINT_VERBOSE("assinged all literals without conflict" << endl);
                 build_sat_proof();
                 print_status(conflict_counter,restart_counter, learn_limit);
                 return true; // SAT
             }
 
-            if ( current_level() == 0 ) {
-                //simplify(clauses);
-                //simplify(learned);
-            }
-
             // if the learning limit is reached, the learned clause must
             // be reduced, the new learning limit is now higher
-            if ( param.enable_deletion && learned.size() >= learn_limit ) {
+            if ( param.enable_deletion && local_learned >= learn_limit ) {
                 // cast for suppres warning
                 reduce_learned();
+                check_garbage();
+                report_progress();
             }
 
-            if ( param.enable_restart &&
-                    conflict_counter >= param.restart_threshold ) {
-                // if the restart limit is reached, bactrack to level zero
-                // and select the new threshold for the restart process
+            if ( param.enable_restart && restarts->should_restart() ) {
+                // bactrack to level zero, the policy select when the next
+                // restart will happen
                 restart_counter++;
-                param.restart_threshold += new_restart_threshold();
-                PRINT_VERBOSE("restarting. next restart at "<<
-                        param.restart_threshold<< endl);
+                ++stats.restarts;
+                restarts->restart();
+                PRINT_VERBOSE("restarting (" << restarts->name() << ")" << endl);
                 cancel_until(0);
+
+                // at level 0 it is safe to import the clauses shared by
+                // the other solvers, their effect must be propagated
+                if ( exchange != nullptr && import_shared_clauses() ) {
+                    PRINT_VERBOSE("imported a conflict" << endl);
+                    print_status(conflict_counter,restart_counter, learn_limit);
+                    set_root_conflict();
+                    return false; // UNSAT
+                }
+
+                // vivify at level 0, with a budget proportional to the
+                // propagations of the search since the last time
+                if ( param.enable_vivification &&
+                        conflict_counter >= next_vivification ) {
+                    next_vivification = conflict_counter +
+                        param.vivification_interval;
+                    uint64_t budget = static_cast<uint64_t>(
+                            param.vivification_effort * static_cast<double>(
+                                stats.propagations - search_propagations));
+                    if ( vivify(budget) ) {
+                        PRINT_VERBOSE("conflict in vivification" << endl);
+                        print_status(conflict_counter,restart_counter,
+                                learn_limit);
+                        set_root_conflict();
+                        return false; // UNSAT
+                    }
+                    search_propagations = stats.propagations;
+                }
+                report_progress();
+
+                // propagate and decide the assumptions again
+                continue;
             }
 
             // open a new decision level and decide a new literal
             // based on the vsids heuristic
             Literal l = choice_lit();
+            ++stats.decisions;
             PRINT_VERBOSE("decide literal " << l << endl);
             assume(l);
         }
@@ -169,21 +342,195 @@ Literal SATSolver::choice_lit() {
         int val;
         do {
             val = random() % number_of_variable;
-        } while ( values[val] != LIT_UNASIGNED );
+        } while ( values[val] != LIT_UNASIGNED || eliminated[val] );
         return Literal ( val,static_cast<bool>(random() % 2) ) ;
     }
 
     // otherwise select from order
-    return order.decision();
+    var v = order.decision();
+    switch ( param.polarity ) {
+        case POLARITY_POSITIVE: return Literal(v, false);
+        case POLARITY_NEGATIVE: return Literal(v, true);
+        case POLARITY_RANDOM:   return Literal(v, random() % 2);
+        default:
+            // the target phases are used only in the stable phases of the
+            // search
+            return Literal(v, param.enable_target_phase && target_assigned &&
+                    restarts->stable() ? target_phase[v] : saved_phase[v]);
+    }
+}
+
+void SATSolver::update_target_phase() {
+    // the levels before the conflicting one are conflict free
+    size_t consistent = static_cast<size_t>(trail_limit.back());
+    if ( consistent > target_assigned ) {
+        for ( size_t i = 0; i < consistent; ++i )
+            target_phase[trail[i].var()] = trail[i].sign();
+        target_assigned = consistent;
+    }
+    if ( consistent > best_assigned ) {
+        for ( size_t i = 0; i < consistent; ++i )
+            best_phase[trail[i].var()] = trail[i].sign();
+        best_assigned = consistent;
+    }
+}
+
+namespace {
+
+enum rephase_kind {
+    REPHASE_ORIGINAL, REPHASE_INVERTED, REPHASE_BEST, REPHASE_RANDOM,
+    REPHASE_TARGET
+};
+
+// the best phases are used every other time, in between the others
+const rephase_kind rephase_schedule[] = {
+    REPHASE_BEST, REPHASE_ORIGINAL, REPHASE_BEST, REPHASE_INVERTED,
+    REPHASE_BEST, REPHASE_RANDOM, REPHASE_BEST, REPHASE_TARGET
+};
+
+} // end anonymous namespace
+
+void SATSolver::rephase() {
+    const size_t schedule_size =
+        sizeof(rephase_schedule) / sizeof(rephase_schedule[0]);
+    rephase_kind kind = rephase_schedule[rephase_count++ % schedule_size];
+    PRINT_VERBOSE("rephase " << kind << endl);
+
+    for ( unsigned int v = 0; v < number_of_variable; ++v ) {
+        switch ( kind ) {
+            case REPHASE_ORIGINAL:
+                saved_phase[v] = occurrence_balance[v] < 0; break;
+            case REPHASE_INVERTED:
+                saved_phase[v] = occurrence_balance[v] >= 0; break;
+            case REPHASE_BEST:   saved_phase[v] = best_phase[v]; break;
+            case REPHASE_RANDOM: saved_phase[v] = random() % 2; break;
+            case REPHASE_TARGET: saved_phase[v] = target_phase[v]; break;
+        }
+    }
+
+    // the new phases must be used, a new target is recorded from now
+    target_assigned = 0;
+    if ( kind == REPHASE_BEST ) best_assigned = 0;
+}
+
+bool SATSolver::vivify(uint64_t budget) {
+    assert( current_level() == 0 );
+    if ( ! propagation().is_undef() ) return true;
+
+    // every clause is vivified once, the ones with lower glue (and then
+    // higher activity) first
+    vector<CRef> candidates;
+    for ( const auto & c : learned )
+        if ( ca[c].get_tier() != TIER_LOCAL && ! ca[c].is_vivified() )
+            candidates.push_back(c);
+    std::sort(candidates.begin(), candidates.end(), [this](CRef a, CRef b) {
+            const Clause &x = ca[a], &y = ca[b];
+            if ( x.get_glue() != y.get_glue() )
+                return x.get_glue() < y.get_glue();
+            return x.get_activity() > y.get_activity();
+        });
+
+    // the assignments of the vivification must not change the phases
+    vector<bool> phases = saved_phase;
+    uint64_t limit = stats.propagations + budget;
+    size_t strengthened = 0, removed_literals = 0;
+    vector<Literal> original, lits;
+    bool conflict = false;
+    for ( const auto & cr : candidates ) {
+        if ( stats.propagations >= limit || conflict ) break;
+        Clause &c = ca[cr];
+        c.set_vivified(true);
+
+        // the propagation move the literals of the clause, so a copy is used
+        original.assign(c.begin(), c.end());
+        bool satisfied = false;
+        for ( const auto & l : original )
+            satisfied = satisfied || get_asigned_value(l) == LIT_TRUE;
+        if ( satisfied ) continue;
+
+        lits.clear();
+        for ( const auto & l : original ) {
+            literal_value v = get_asigned_value(l);
+            if ( v == LIT_FALSE ) continue; // implied by the others
+            lits.push_back(l);
+            if ( v == LIT_TRUE ) {
+                // implied by the previous literals, unless the clause
+                // itself is the reason (and then the others are false)
+                if ( antecedents[l.var()] != Antecedent(cr) ) break;
+                continue;
+            }
+            assume(!l);
+            if ( ! propagation().is_undef() ) break;
+        }
+        cancel_until(0);
+        if ( lits.size() == original.size() ) continue;
+
+        ++strengthened;
+        removed_literals += original.size() - lits.size();
+        if ( proof != nullptr ) {
+            proof->add(lits);
+            proof->remove(original);
+        }
+        PRINT_VERBOSE("vivify " << c.print() << " to " << lits << endl);
+        remove_from_vect(watch_list[c[0].index()], cr);
+        remove_from_vect(watch_list[c[1].index()], cr);
+        if ( lits.size() > 2 ) {
+            // the clause is shorter, but it is still the same learned clause
+            std::copy(lits.begin(), lits.end(), c.begin());
+            ca.shrink(cr, lits.size());
+            c.set_glue(std::min<unsigned int>(c.get_glue(),
+                        static_cast<unsigned int>(lits.size()) - 1));
+            watch_list[c[0].index()].push_back(Watcher(cr,c[1]));
+            watch_list[c[1].index()].push_back(Watcher(cr,c[0]));
+            continue;
+        }
+
+        // binary and unit clauses are not in the learned clauses, the
+        // freed clause is removed from them at the end
+        ca.free(cr);
+        if ( lits.size() == 2 )
+            attach_binary(lits[0], lits[1]);
+        else
+            conflict = assign(lits[0], Antecedent()) ||
+                ! propagation().is_undef();
+    }
+    saved_phase = phases;
+
+    size_t j = 0;
+    for ( const auto & c : learned )
+        if ( ! ca[c].is_deleted() ) learned[j++] = c;
+    learned.resize( j );
+    PRINT_VERBOSE("vivification: strengthened " << strengthened <<
+            " clauses, removed " << removed_literals << " literals" << endl);
+    return conflict;
 }
 
-void SATSolver::simplify( vector<ClausePtr> &vect) {
+void SATSolver::simplify_database() {
     assert(current_level() == 0);
     assert(propagation_starting_pos == trail.size());
+    write_proof_units();
+    simplify(clauses);
+    simplify(learned);
+    sweep_watch_lists();
+
+    // the reasons of the assignments at level 0 are never used, and they
+    // can be deleted clauses now
+    for ( const auto & l : trail ) antecedents[l.var()] = Antecedent();
+
+    simplified_assigned = trail.size();
+    next_simplify = stats.propagations + (ca.size() - ca.wasted());
+    check_garbage();
+}
+
+void SATSolver::simplify( vector<CRef> &vect) {
     size_t j = 0;
     for ( auto & c : vect ) {
-        if ( simplify_clause(c) )
-            remove_clause(c);
+        if ( simplify_clause(c) ) {
+            const Clause &cl = ca[c];
+            if ( cl.is_learned() && cl.get_tier() == TIER_LOCAL )
+                --local_learned;
+            ca.free(c);
+        }
         else
             vect[j++] = c;
     }
@@ -191,22 +538,47 @@ void SATSolver::simplify( vector<ClausePtr> &vect) {
     vect.resize(j);
 }
 
-bool SATSolver::simplify_clause( ClausePtr c ) {
-    size_t j = 0;
-    for ( const auto & l : *c ) {
-        if ( get_asigned_value(l) == LIT_TRUE )
+bool SATSolver::simplify_clause( CRef cr ) {
+    Clause &c = ca[cr];
+    for ( const auto & l : c ) {
+        if ( get_asigned_value(l) == LIT_TRUE ) {
+            if ( proof != nullptr ) proof->remove(c);
             return true; // useless
+        }
+    }
+    if ( proof != nullptr ) proof_clause.assign(c.begin(), c.end());
+    size_t j = 0;
+    for ( const auto & l : c )
         if ( get_asigned_value(l) == LIT_UNASIGNED )
-            c->at(j++) = l;
+            c[j++] = l;
+    // after the propagation, the watched literals of a clause not satisfied
+    // are unassigned, so they are still in the first two positions
+    assert(j >= 2);
+    if ( proof != nullptr && j < c.size() ) {
+        proof->add(c.begin(), c.begin() + j);
+        proof->remove(proof_clause);
+    }
+    ca.shrink(cr,j);
+    if ( j > 2 ) return false; // still usefull
+
+    attach_binary(c[0], c[1]);
+    if ( ! c.is_learned() ) number_of_binary_clauses++;
+    return true;
+}
+
+void SATSolver::sweep_watch_lists() {
+    for ( auto & ws : watch_list ) {
+        ws.erase(std::remove_if(ws.begin(), ws.end(),
+                    [this](const Watcher &w) {
+                        return ca[w.clause].is_deleted(); }),
+                ws.end());
     }
-    c->shrink(j);
-    return false; // still usefull
 }
 
 bool SATSolver::assume( Literal p ) {
     assert( get_asigned_value(p) == LIT_UNASIGNED);
     trail_limit.push_back(static_cast<int>(trail.size()));
-    return assign(p, nullptr);
+    return assign(p, Antecedent());
 }
 
 void SATSolver::cancel() {
@@ -226,46 +598,28 @@ void SATSolver::cancel_until( int level ) {
     while ( current_level() > level )
         cancel();
     propagation_starting_pos = trail.size();
+    binary_propagation_pos = trail.size();
 }
 
 void SATSolver::print_status(unsigned int conflict, unsigned int restart,
         unsigned int learn_limit) {
     PRINT("conflict: " << setw(7) << conflict);
     if ( param.enable_restart )
-        PRINT(", restart: " << setw(7) <<  restart);
+        PRINT(", restart: " << setw(7) <<  restart << " (" <<
+                restarts->name() << ")");
     if ( param.enable_deletion )
         PRINT(", learn limit: " << setw(7) <<  learn_limit);
     PRINT(", learned: " << setw(7) <<  learned.size() << endl);
 }
 
-unsigned int SATSolver::next_restart_interval( unsigned int pos) {
-    // use the luby sequence for evaluating the new interval
-    // the code is based on minisat
-    unsigned int size, seq;
-
-    // find in what sequence we are, the sequence i have lenght (2^i)-1
-    for ( size = 1, seq = 0; size < pos+1; ++seq, size = 2*size + 1 )
-        ;
-
-    // find the value inside the sequence
-    while ( (size-1) != pos ) {
-        size /= 2;
-        --seq;
-        pos %= size; // NOLINT(clang-analyzer-core.DivideZero)
-    }
-
-    return 1 << seq; // 2^seq
-}
-
-unsigned int SATSolver::new_restart_threshold() {
-    return param.restart_interval_multiplier*next_restart_interval(luby_next++);
-}
-
 void SATSolver::build_sat_proof() {
     int val = 1;
     model.clear();
+    // the eliminated variables take the value that satisfy their clauses
+    vector<literal_value> full_model = values;
+    extension.extend(full_model);
     // map the assigned value to an int rappresentation in DIMACS format
-    transform(values.begin(), values.end(), back_inserter(model),
+    transform(full_model.begin(), full_model.end(), back_inserter(model),
             [&val](literal_value v) { return v == LIT_TRUE ? val++ : -val++; });
 }
 
@@ -289,7 +643,7 @@ literal_value SATSolver::get_asigned_value(const Literal & l) const {
     return values[l.var()];
 }
 
-bool SATSolver::assign(Literal l, ClausePtr antecedent) {
+bool SATSolver::assign(Literal l, Antecedent antecedent) {
     // already assigned ?
     if ( get_asigned_value(l) == LIT_TRUE )
         return false; // already assigned, no conflict
@@ -298,7 +652,8 @@ bool SATSolver::assign(Literal l, ClausePtr antecedent) {
 
     PRINT_VERBOSE("\tassign literal " << l <<
         ",  level " << current_level() << ", antecedent " <<
-        (antecedent == nullptr ? "NONE" : antecedent->print() ) << endl);
+        (antecedent.is_undef() ? "NONE" : antecedent.is_binary() ?
+         antecedent.get_literal().print() : ca[antecedent.ref].print() ) << endl);
 
     // unassigned, update asignment
     values[l.var()] = l.sign() ? LIT_FALSE : LIT_TRUE;
@@ -315,28 +670,56 @@ size_t SATSolver::number_of_assigned_variable() const {
     return trail.size();
 }
 
-SATSolver::ClausePtr SATSolver::propagation() {
+SATSolver::Antecedent SATSolver::propagation() {
 
     while ( propagation_starting_pos < trail.size() ) {
 
+        // propagate all the binary clauses, until a fixpoint is reached
+        while ( binary_propagation_pos < trail.size() ) {
+            auto failed = !trail[binary_propagation_pos++];
+            stats.binary_visits += binary_watch_list[failed.index()].size();
+            for ( const auto & l : binary_watch_list[failed.index()] ) {
+                // the antecedent is the other literal of the binary clause
+                if ( ! assign(l,Antecedent(failed)) ) continue;
+
+                PRINT_VERBOSE("\tfound a conflict on {" << failed << "," <<
+                        l << "}" << endl);
+                binary_conflict[0] = failed;
+                binary_conflict[1] = l;
+                return Antecedent(failed);
+            }
+        }
+
         PRINT_VERBOSE("propagate " << trail[propagation_starting_pos] << endl);
 
         // extract the list of the opposite literal 
         // (they are false now, their watcher must be moved)
         auto failed = !trail[propagation_starting_pos++];
+        ++stats.propagations;
         propagation_to_move.clear();
         swap(propagation_to_move,watch_list[failed.index()]);
+        stats.watch_visits += propagation_to_move.size();
 
         for (auto it = propagation_to_move.begin();
                 it != propagation_to_move.end(); ++it) {
 
+            // if the blocker is true the clause is already solved, skip it
+            // without looking at the clause
+            if (get_asigned_value(it->blocker) == LIT_TRUE) {
+                watch_list[failed.index()].push_back(*it);
+                continue; // move to the next
+            }
+
             // propagate effect on a clause
-            Clause &c = *(it->get_clause()); // usefull reference
+            Clause &c = ca[it->clause]; // usefull reference
             assert(c[0]==failed || c[1]==failed);
 
             // make sure the false literal is in position 1
             if ( c[0] == failed ) { c[0] = c[1]; c[1] = failed; }
 
+            // the other watched literal is the new blocker
+            it->blocker = c[0];
+
             // if the clause is already solved, nothing need to be moved
             if (get_asigned_value(c[0]) == LIT_TRUE) {
                 // reinsert inside the previous watch list
@@ -363,27 +746,26 @@ SATSolver::ClausePtr SATSolver::propagation() {
             watch_list[failed.index()].push_back(*it);
 
             // the clause must be a conflict or a unit, try to assign the value
-            bool conflict = assign(c[0],it->get_clause());
+            bool conflict = assign(c[0],Antecedent(it->clause));
             if ( ! conflict ) continue; // no problem, move to the next
 
             // conflict found in propagation 
-            PRINT_VERBOSE("\tfound a conflict on " << (it->get_clause())->print() << endl);
-            ClausePtr conflict_clause = it->get_clause();
+            PRINT_VERBOSE("\tfound a conflict on " << c.print() << endl);
+            CRef conflict_clause = it->clause;
 
             // reset the other literal to move (it is already set by propagate)
             copy(++it, propagation_to_move.end(),
                     back_inserter(watch_list[failed.index()]));
 
-            return conflict_clause;
+            return Antecedent(conflict_clause);
         }
     }
-    return nullptr; // no conflict
+    return Antecedent(); // no conflict
 }
 
-void SATSolver::conflict_analysis(ClausePtr conflict,
+void SATSolver::conflict_analysis(Antecedent conflict,
         vector<Literal> &out_learnt, int &out_btlevel) {
     assert(out_learnt.empty());
-    std::fill(analisys_seen.begin(), analisys_seen.end(),false);
     int counter = 0;
     Literal p = UNDEF_LIT;
 
@@ -391,78 +773,170 @@ void SATSolver::conflict_analysis(ClausePtr conflict,
     // free space for assertion literal
     out_learnt.push_back(Literal());
 
+    // q is a false literal in the reason of p
+    auto trace = [&](Literal q) {
+        var v = q.var();
+        if ( analisys_seen[v] != SEEN_UNDEF || decision_levels[v] == 0 )
+            return;
+        analisys_seen[v] = SEEN_SOURCE;
+        if ( decision_levels[v] == current_level() )
+            ++counter;
+        else {
+            out_learnt.push_back(q);
+            out_btlevel = max(out_btlevel, decision_levels[v]);
+        }
+    };
+
     do {
-        // remove ol reason
-        analisys_reason.clear();
-
-        // increase activity for conflict clause
-        if ( conflict->is_learned() )
-            conflict->update_activity(param.clause_activity_update);
-
-        // calculate the reason for the literal p
-        // the reason is the set of literals that make this literal false
-        for( auto it = p != UNDEF_LIT ? conflict->begin()+1 : conflict->begin();
-                it != conflict->end(); ++it)
-            analisys_reason.push_back( !(*it) );
-
-        // trace reason of P
-        for ( const auto &q : analisys_reason ) {
-            if ( ! analisys_seen[q.var()] ) {
-                analisys_seen[q.var()] = true;
-                if ( decision_levels[q.var()] == current_level() )
-                    ++counter;
-                else if ( decision_levels[q.var()] > 0 ) {
-                    out_learnt.push_back(!q);
-                    out_btlevel = max(out_btlevel, decision_levels[q.var()]);
+        // trace the reason for the literal p, the set of literals that make
+        // this literal true
+        if ( conflict.is_binary() ) {
+            if ( p == UNDEF_LIT )
+                for ( const auto & l : binary_conflict ) trace(l);
+            else
+                trace(conflict.get_literal());
+        }
+        else {
+            Clause &c = ca[conflict.ref];
+
+            // increase activity for conflict clause, and update its glue:
+            // a clause that improve is promoted to a better tier
+            if ( c.is_learned() ) {
+                c.update_activity(param.clause_activity_update);
+                c.set_used(true);
+                if ( c.get_tier() != TIER_CORE ) {
+                    unsigned int glue = clause_glue(c);
+                    if ( glue < c.get_glue() ) {
+                        c.set_glue(glue);
+                        clause_tier tier = glue_tier(glue);
+                        if ( tier < c.get_tier() ) {
+                            if ( c.get_tier() == TIER_LOCAL ) --local_learned;
+                            c.set_tier(tier);
+                        }
+                    }
                 }
             }
+
+            for( auto it = p != UNDEF_LIT ? c.begin()+1 : c.begin();
+                    it != c.end(); ++it)
+                trace(*it);
         }
+
+        // the literals of the conflict level are not in the learned clause,
+        // their flag is reset as soon as they are reached
         do {
             p = trail.back();
             conflict = antecedents[p.var()];
             undo_one();
-        } while ( ! analisys_seen[p.var()] );
+        } while ( analisys_seen[p.var()] == SEEN_UNDEF );
+        analisys_seen[p.var()] = SEEN_UNDEF;
         --counter;
     } while ( counter > 0 );
     out_learnt[0] = !p;
 
+    analisys_clear.assign(out_learnt.begin() + 1, out_learnt.end());
+    stats.uip_literals += out_learnt.size();
     if (param.enable_conflict_semplification) {
-        // try to simplify the conflict clause to learn, with a self subsumption
-        // from the reasons of all the literals
-        unsigned int i, j;
-        for (i = j = 1; i < out_learnt.size(); i++){
+        // remove the literals implied by the others literals of the clause
+        // (recursive minimization). A literal with a decision level not in
+        // the clause can't be implied, the abstract levels check it quickly
+        uint32_t abstract_levels = 0;
+        for ( size_t i = 1; i < out_learnt.size(); ++i )
+            abstract_levels |= abstract_level(out_learnt[i].var());
+
+        size_t i, j;
+        for ( i = j = 1; i < out_learnt.size(); ++i ) {
+            if ( antecedents[out_learnt[i].var()].is_undef() ||
+                    ! literal_redundant(out_learnt[i], abstract_levels) )
+                out_learnt[j++] = out_learnt[i];
+        }
+        out_learnt.resize(j);
+    }
+    stats.learned_literals += out_learnt.size();
 
-            ClausePtr c = antecedents[out_learnt[i].var()];
+    // only the touched flags are reset
+    for ( const auto & l : analisys_clear )
+        analisys_seen[l.var()] = SEEN_UNDEF;
+}
 
-            if ( c == nullptr ) {
-                out_learnt[j++] = out_learnt[i];
+Literal SATSolver::reason_literal(var v, size_t i) const {
+    Antecedent a = antecedents[v];
+    if ( a.is_binary() ) return a.get_literal();
+    return ca[a.ref][i+1]; // the implied literal is the first one
+}
+
+size_t SATSolver::reason_size(var v) const {
+    Antecedent a = antecedents[v];
+    if ( a.is_binary() ) return 1;
+    return ca[a.ref].size() - 1;
+}
+
+bool SATSolver::literal_redundant(Literal p, uint32_t abstract_levels) {
+    // depth first visit of the implication graph, without recursion. When
+    // a literal is not implied, all the literals on the stack are not
+    // implied too
+    analisys_stack.clear();
+    size_t i = 0;
+    while ( true ) {
+        if ( i < reason_size(p.var()) ) {
+            Literal l = reason_literal(p.var(), i);
+            var v = l.var();
+
+            // already in the clause, already removable, or at level 0
+            if ( decision_levels[v] == 0 || analisys_seen[v] == SEEN_SOURCE ||
+                    analisys_seen[v] == SEEN_REMOVABLE ) {
+                ++i;
                 continue;
             }
 
-            for (unsigned int k = 1; k < c->size(); k++) {
-                if (!analisys_seen[c->at(k).var()] &&
-                        decision_levels[c->at(k).var()] != 0){
-                    out_learnt[j++] = out_learnt[i];
-                    break;
+            // a decision or a literal that can't be implied
+            if ( antecedents[v].is_undef() ||
+                    analisys_seen[v] == SEEN_FAILED ||
+                    ( abstract_level(v) & abstract_levels ) == 0 ) {
+                analisys_stack.push_back({0, p});
+                for ( const auto & f : analisys_stack ) {
+                    if ( analisys_seen[f.l.var()] == SEEN_UNDEF ) {
+                        analisys_seen[f.l.var()] = SEEN_FAILED;
+                        analisys_clear.push_back(f.l);
+                    }
                 }
+                return false;
             }
+
+            // visit the reason of l
+            analisys_stack.push_back({i, p});
+            i = 0;
+            p = l;
+        }
+        else {
+            // all the reason of p is implied
+            if ( analisys_seen[p.var()] == SEEN_UNDEF ) {
+                analisys_seen[p.var()] = SEEN_REMOVABLE;
+                analisys_clear.push_back(p);
+            }
+            if ( analisys_stack.empty() ) return true;
+
+            // continue with the parent
+            i = analisys_stack.back().i + 1;
+            p = analisys_stack.back().l;
+            analisys_stack.pop_back();
         }
-        out_learnt.resize(j);
     }
 }
 
 void SATSolver::undo_one() {
     Literal p = trail.back();
     values[p.var()] = LIT_UNASIGNED;
-    antecedents[p.var()] = nullptr;
+    antecedents[p.var()] = Antecedent();
     decision_levels[p.var()]  = -1;
+    saved_phase[p.var()] = p.sign();
     order.insert(p.var());
     trail.pop_back();
 }
 
-bool SATSolver::new_clause(vector<Literal> &c, bool learnt, ClausePtr &c_ref) {
+bool SATSolver::new_clause(vector<Literal> &c, bool learnt, CRef &c_ref) {
 
-    c_ref = nullptr;
+    c_ref = CREF_UNDEF;
 
     if ( ! learnt ) { // simplify if possible, learned clause doesn't need this
         size_t j = 0;
@@ -470,8 +944,10 @@ bool SATSolver::new_clause(vector<Literal> &c, bool learnt, ClausePtr &c_ref) {
             // discard false literal
             if ( get_asigned_value( c[i] ) == LIT_FALSE ) continue;
             // already satisfied?
-            if ( get_asigned_value( c[i] ) == LIT_TRUE  )
-                return false; // no conflict, new clause is a nullptr
+            if ( get_asigned_value( c[i] ) == LIT_TRUE  ) {
+                c.clear();
+                return false; // no conflict, new clause is undefined
+            }
             // look for tautology or repetition
             bool add = true;
             for ( size_t k = i+1; k < c.size(); ++k ) {
@@ -479,8 +955,10 @@ bool SATSolver::new_clause(vector<Literal> &c, bool learnt, ClausePtr &c_ref) {
                     add = false;      // don't add the repeated literal
                     break;
                 }
-                if ( c[k] == !(c[i]) ) // tautology?
-                    return false; // no conflict, new clause is a nullptr 
+                if ( c[k] == !(c[i]) ) { // tautology?
+                    c.clear();
+                    return false; // no conflict, new clause is undefined
+                } 
             }
             if ( add ) c[j++] = c[i];
         }
@@ -488,92 +966,500 @@ bool SATSolver::new_clause(vector<Literal> &c, bool learnt, ClausePtr &c_ref) {
     }
 
     // an empty clause is a conflict
-    if (c.empty()) return true; // conflict, cnew clause is a nullptr
+    if (c.empty()) return true; // conflict, cnew clause is undefined
 
     // a clause with 1 literal is a unit, simply assign it
     if ( c.size() == 1 ) {
         // true if the assignment is in conflict, false otherwise
-        // the new clause is a nullptr (don't build clause of one literal)
-        return  assign( c[0], nullptr );
+        // the new clause is undefined (don't build clause of one literal)
+        return  assign( c[0], Antecedent() );
+    }
+
+    // a clause with 2 literals is kept only in the binary watch lists
+    // (for a learned clause, the literal in position 0 is the unasigned one)
+    if ( c.size() == 2 ) {
+        attach_binary(c[0],c[1]);
+        return false; // no conflict
     }
 
     // build the clause
-    c_ref = Clause::allocate(c,learnt);
+    c_ref = ca.allocate(c,learnt);
+    Clause &cl = ca[c_ref];
 
     if ( learnt ) { 
         // pick a correct second literal to watch
-        auto second = c_ref->begin()+1;
-        for ( auto it = c_ref->begin()+2; it != c_ref->end(); ++it)
+        auto second = cl.begin()+1;
+        for ( auto it = cl.begin()+2; it != cl.end(); ++it)
             if ( decision_levels[it->var()] > decision_levels[second->var()] )
                 second = it;
         // swap
         Literal tmp = *second;
-        *second = c_ref->at(1);
-        c_ref->at(1) = tmp;
+        *second = cl[1];
+        cl[1] = tmp;
 
         // increase activity
-        c_ref->update_activity( param.clause_activity_update );
+        cl.update_activity( param.clause_activity_update );
     }
 
     //  add to the watch list
-    watch_list[c_ref->at(0).index()].push_back(Watcher(c_ref));
-    watch_list[c_ref->at(1).index()].push_back(Watcher(c_ref));
+    watch_list[cl[0].index()].push_back(Watcher(c_ref,cl[1]));
+    watch_list[cl[1].index()].push_back(Watcher(c_ref,cl[0]));
 
     return false; // no conflict
 }
 
+void SATSolver::attach_binary(Literal a, Literal b) {
+    // when a literal become false, the other one is implied
+    binary_watch_list[a.index()].push_back(b);
+    binary_watch_list[b.index()].push_back(a);
+}
+
 bool SATSolver::add_clause(vector<Literal>& lits) {
+    // the clause is simplified with the values at level 0, the assignment
+    // of a previous solve must be removed
+    if ( current_level() > 0 ) cancel_until(0);
+    if ( root_conflict ) return true;
+    for ( const auto & l : lits )
+        if ( l.var() < number_of_variable && eliminated[l.var()] ) {
+            if ( restore_eliminated() ) return true;
+            break;
+        }
+
     // build the new clause
-    ClausePtr clause;
+    CRef clause;
+    size_t original_size = lits.size();
     bool conflict = new_clause(lits, false, clause);
     // if the clause is a conflict, return immediatly
-    if ( conflict ) return true; // conflict
-    // clause is nullptr if the new clause is a unit
-    if ( clause != nullptr ) {
-        clauses.push_back(clause);
-        // initialize vsids info
-        for ( const auto& l : *clause ) literals_activity[l.index()]+=1.0;
-
+    if ( conflict ) {
+        set_root_conflict();
+        return true; // conflict
     }
+    // the clause without the false literals is a lemma (an empty vector is
+    // a satisfied clause)
+    if ( proof != nullptr && ! lits.empty() && lits.size() < original_size )
+        proof->add(lits);
+    // clause is undefined if the new clause is a unit or a binary clause
+    if ( clause != CREF_UNDEF ) clauses.push_back(clause);
+    if ( lits.size() == 2 ) number_of_binary_clauses++;
+
+    // initialize vsids info
+    if ( lits.size() >= 2 )
+        for ( const auto& l : lits ) {
+            variables_activity[l.var()]+=1.0;
+            // the initial phase is the polarity with more occurrences
+            occurrence_balance[l.var()] += l.sign() ? -1 : 1;
+            saved_phase[l.var()] = occurrence_balance[l.var()] < 0;
+            target_phase[l.var()] = saved_phase[l.var()];
+            best_phase[l.var()] = saved_phase[l.var()];
+        }
+
     return false; // no conflict
 }
 
-void SATSolver::learn_clause(vector<Literal> & lits) {
+void SATSolver::learn_clause(vector<Literal> & lits, unsigned int glue) {
     PRINT_VERBOSE("learn clause " << lits << endl);
+    if ( proof != nullptr ) proof->add(lits);
     // build the new clause, it's never a conflict if the clause is learned
-    ClausePtr clause;
+    CRef clause;
     new_clause(lits, true, clause);
     // the learned clause is always a unit, with the unasigned literal in 0
-    assign(lits[0],clause);
+    if ( lits.size() == 2 )
+        assign(lits[0],Antecedent(lits[1]));
+    else
+        assign(lits[0],Antecedent(clause));
     PRINT_VERBOSE("address " << clause << endl);
-    // if the clause have only one literal, don't add that to the list
-    if ( clause != nullptr ) {
+    // if the clause have only one or two literals, don't add that to the list
+    if ( clause != CREF_UNDEF ) {
+        Clause &c = ca[clause];
+        c.set_glue(glue);
+        c.set_tier(glue_tier(glue));
+        if ( c.get_tier() == TIER_LOCAL ) ++local_learned;
         learned.push_back(clause);
-        // initialize vsids info
-        for ( const auto& l : *clause ) {
-            literals_activity[l.index()] += param.clause_activity_update;
-            order.increase_activity(l);
+    }
+
+    // initialize vsids info
+    if ( lits.size() >= 2 ) {
+        for ( const auto& l : lits ) {
+            variables_activity[l.var()] += param.clause_activity_update;
+            order.increase_activity(l.var());
         }
     }
 }
 
-// Nothing for now
-void SATSolver::preprocessing() {}
+unsigned int SATSolver::compute_lbd(const vector<Literal> &lits) {
+    // use a stamp for each level, to avoid clearing the vector every time
+    if ( ++lbd_stamp == 0 ) {
+        std::fill(lbd_seen.begin(), lbd_seen.end(), 0);
+        lbd_stamp = 1;
+    }
+    unsigned int lbd = 0;
+    for ( const auto & l : lits ) {
+        int level = decision_levels[l.var()];
+        if ( level < 0 ) continue;
+        if ( static_cast<size_t>(level) >= lbd_seen.size() )
+            lbd_seen.resize(level+1, 0);
+        if ( lbd_seen[level] != lbd_stamp ) {
+            lbd_seen[level] = lbd_stamp;
+            ++lbd;
+        }
+    }
+    return lbd;
+}
 
-void SATSolver::remove_from_vect( vector<ClausePtr> &v, ClausePtr c ) {
-    for ( auto &i : v ) {
-        if ( i == c ) {
-            i = v.back();
-            v.pop_back();
-            return;
+unsigned int SATSolver::clause_glue(const Clause &c) {
+    if ( ++lbd_stamp == 0 ) {
+        std::fill(lbd_seen.begin(), lbd_seen.end(), 0);
+        lbd_stamp = 1;
+    }
+    // the current level is always in the clause
+    if ( static_cast<size_t>(current_level()) >= lbd_seen.size() )
+        lbd_seen.resize(current_level()+1, 0);
+    lbd_seen[current_level()] = lbd_stamp;
+    unsigned int glue = 1;
+    for ( const auto & l : c ) {
+        int level = decision_levels[l.var()];
+        if ( level < 0 || lbd_seen[level] == lbd_stamp ) continue;
+        lbd_seen[level] = lbd_stamp;
+        ++glue;
+    }
+    return glue;
+}
+
+clause_tier SATSolver::glue_tier(unsigned int glue) const {
+    if ( glue <= param.core_glue ) return TIER_CORE;
+    if ( glue <= param.mid_glue ) return TIER_MID;
+    return TIER_LOCAL;
+}
+
+void SATSolver::export_clause(const vector<Literal> &lits, unsigned int glue) {
+    // rate limit, the budget increase at each conflict
+    export_budget = std::min(export_budget + param.share_export_rate, 100.0);
+    if ( export_budget < 1.0 ) return;
+
+    // only short clauses, or clauses with a good quality
+    if ( lits.size() > param.share_max_size && glue > param.share_max_lbd )
+        return;
+
+    if ( exchange->publish(exchange_id, lits) ) {
+        export_budget -= 1.0;
+        ++exported_clauses;
+    }
+}
+
+bool SATSolver::import_shared_clauses() {
+    bool conflict = false;
+    exchange->collect(exchange_id, exchange_cursor, [&](vector<Literal> &c) {
+            if ( ! conflict ) conflict = import_clause(c);
+        });
+    return conflict;
+}
+
+bool SATSolver::import_clause(vector<Literal> &lits) {
+    // clauses are imported only at level 0, so all the assigned literals are
+    // permanent: the false ones are removed and a satisfied clause is useless.
+    // The remaining literals are unassigned and can be watched
+    assert( current_level() == 0 );
+    size_t j = 0;
+    for ( const auto & l : lits ) {
+        if ( l.var() >= number_of_variable || eliminated[l.var()] )
+            return false; // not for us
+        if ( get_asigned_value(l) == LIT_TRUE ) return false;
+        if ( get_asigned_value(l) == LIT_UNASIGNED ) lits[j++] = l;
+    }
+    lits.resize(j);
+    ++imported_clauses;
+
+    CRef clause;
+    if ( new_clause(lits, true, clause) ) return true; // conflict
+    if ( clause != CREF_UNDEF ) {
+        // the glue is unknown, the size is an upper bound
+        Clause &c = ca[clause];
+        c.set_tier(glue_tier(c.get_glue()));
+        if ( c.get_tier() == TIER_LOCAL ) ++local_learned;
+        learned.push_back(clause);
+    }
+    return false;
+}
+
+// the assumptions responsible for the falsification of p
+void SATSolver::analyze_final(Literal p) {
+    // p is false, follow its implication graph back to the decisions: at
+    // this point all the decisions are assumptions
+    failed_assumptions.clear();
+    failed_assumptions.push_back(p);
+    if ( decision_levels[p.var()] == 0 ) return;
+
+    analisys_seen[p.var()] = SEEN_SOURCE;
+    for ( size_t i = trail.size(); i > static_cast<size_t>(trail_limit[0]); ) {
+        Literal q = trail[--i];
+        if ( analisys_seen[q.var()] == SEEN_UNDEF ) continue;
+        analisys_seen[q.var()] = SEEN_UNDEF;
+
+        Antecedent a = antecedents[q.var()];
+        if ( a.is_undef() ) {
+            failed_assumptions.push_back(q);
+        }
+        else if ( a.is_binary() ) {
+            Literal r = a.get_literal();
+            if ( decision_levels[r.var()] > 0 )
+                analisys_seen[r.var()] = SEEN_SOURCE;
+        }
+        else {
+            const Clause &c = ca[a.ref];
+            for ( unsigned int k = 1; k < c.size(); ++k )
+                if ( decision_levels[c[k].var()] > 0 )
+                    analisys_seen[c[k].var()] = SEEN_SOURCE;
         }
     }
-    assert(false);
 }
 
-void SATSolver::remove_from_vect( vector<Watcher> &v, ClausePtr c ) {
+bool SATSolver::preprocessing(const vector<Literal> &assumptions) {
+    // the preprocessing is done only once, before the first search: all the
+    // clauses are original, and the learned clauses don't exist yet
+    if ( preprocessed ) return false;
+    preprocessed = true;
+    assert( current_level() == 0 && learned.empty() );
+
+    // the values at level 0 simplify the clauses
+    if ( ! propagation().is_undef() ) return true;
+
+    if ( probe() ) return true;
+
+    Clause_Simplifier simplifier(number_of_variable);
+    simplifier.set_proof(proof);
+    write_proof_units();
+    for ( const auto & p : assumptions ) simplifier.freeze(p.var());
+    for ( const auto & l : trail ) simplifier.freeze(l.var());
+
+    // call f with every clause of the formula in lits. The binary clauses
+    // are in two binary watch lists, they are taken only once
+    vector<Literal> lits, copy;
+    auto for_each_original = [&](const std::function<void()> &f) {
+        for ( const auto & c : clauses ) {
+            lits.assign(ca[c].begin(), ca[c].end());
+            f();
+        }
+        for ( size_t i = 0; i < binary_watch_list.size(); ++i ) {
+            Literal a = Literal::from_index(static_cast<int>(i));
+            for ( const auto & b : binary_watch_list[i] ) {
+                if ( b.index() < a.index() ) continue;
+                lits = { a, b };
+                f();
+            }
+        }
+    };
+    // copy lits without the assigned literals, false if it is satisfied
+    auto strip = [&]() {
+        copy.clear();
+        for ( const auto & l : lits ) {
+            if ( get_asigned_value(l) == LIT_TRUE ) return false;
+            if ( get_asigned_value(l) == LIT_UNASIGNED ) copy.push_back(l);
+        }
+        return true;
+    };
+
+    // the simplifier works on a copy of the formula. In the proof only the
+    // copies with a false literal are new clauses, the simplifier write
+    // its own changes
+    size_t original_clauses = clauses.size() + number_of_binary_clauses;
+    for_each_original([&]() {
+            if ( ! strip() ) return;
+            if ( proof != nullptr && copy.size() < lits.size() )
+                proof->add(copy);
+            simplifier.add_clause(copy);
+        });
+
+    unsigned int threads = param.preprocessing_threads;
+    if ( threads == 0 )
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    if ( ! simplifier.substitute(extension) ) return true;
+    if ( ! simplifier.subsume(threads) ) return true;
+    if ( ! simplifier.eliminate(extension) ) return true;
+    if ( simplifier.eliminated_variables() == 0 &&
+            simplifier.substituted_variables() == 0 &&
+            simplifier.subsumed_clauses() == 0 &&
+            simplifier.strengthened_clauses() == 0 ) {
+        // the formula is kept, the new copies are useless
+        if ( proof != nullptr )
+            for_each_original([&]() {
+                    if ( strip() && copy.size() < lits.size() )
+                        proof->remove(copy);
+                });
+        return false;
+    }
+
+    // replace the formula with the simplified one. The reasons of the
+    // assignments at level 0 are never used, and they can be removed
+    for ( const auto & l : trail ) antecedents[l.var()] = Antecedent();
+    // the original clauses equal to their copy are already removed by the
+    // simplifier, or they are still in the formula
+    if ( proof != nullptr )
+        for_each_original([&]() {
+                if ( ! strip() || copy.size() < lits.size() )
+                    proof->remove(lits);
+            });
+    for ( const auto & c : clauses ) ca.free(c);
+    clauses.clear();
+    for ( auto & ws : watch_list ) ws.clear();
+    for ( auto & ws : binary_watch_list ) ws.clear();
+    number_of_binary_clauses = 0;
+
+    for ( unsigned int v = 0; v < number_of_variable; ++v ) {
+        if ( ! simplifier.is_eliminated(v) ) continue;
+        eliminated[v] = true;
+        ++number_of_eliminated;
+        order.remove(v);
+    }
+
+    bool conflict = false;
+    simplifier.for_each_clause([&](const vector<Literal> &c) {
+            if ( conflict ) return;
+            lits = c;
+            CRef clause;
+            conflict = new_clause(lits, false, clause);
+            if ( clause != CREF_UNDEF ) clauses.push_back(clause);
+            if ( lits.size() == 2 ) number_of_binary_clauses++;
+        });
+    check_garbage();
+
+    PRINT("preprocessing: substituted " <<
+            simplifier.substituted_variables() <<
+            ", subsumed " << simplifier.subsumed_clauses() <<
+            ", strengthened " << simplifier.strengthened_clauses() <<
+            ", eliminated " << simplifier.eliminated_variables() <<
+            " variables, clauses " << original_clauses << " -> " <<
+            clauses.size() + number_of_binary_clauses << endl);
+    return conflict;
+}
+
+bool SATSolver::probe() {
+    // a literal l is a candidate if it implies something by a binary
+    // clause. The roots of the binary implication graph are probed first,
+    // they imply the most literals
+    vector<Literal> candidates;
+    for ( unsigned int v = 0; v < number_of_variable; ++v ) {
+        if ( values[v] != LIT_UNASIGNED ) continue;
+        for ( Literal l : { Literal(v,false), Literal(v,true) } )
+            if ( ! binary_watch_list[(!l).index()].empty() )
+                candidates.push_back(l);
+    }
+    stable_partition(candidates.begin(), candidates.end(),
+            [this](Literal l) {
+                return binary_watch_list[l.index()].empty(); });
+
+    // the probing must not change the initial phases
+    vector<bool> phases = saved_phase;
+    size_t formula = clauses.size() + number_of_binary_clauses;
+    uint64_t budget = uint64_t(probing_effort) * formula;
+    size_t binary_limit = static_cast<size_t>(probing_binaries * formula);
+    size_t failed = 0, binaries = 0;
+
+    // a literal implied by a probe without conflict would find a subset of
+    // the same implications
+    vector<bool> implied(2 * number_of_variable, false);
+    // the literals implied by a probe form a tree: the parent of a literal
+    // is the other literal of its binary clause, or the dominator of the
+    // false literals of its long clause
+    vector<Literal> parent(2 * number_of_variable);
+    vector<unsigned int> depth(2 * number_of_variable, 0);
+    auto dominator = [&](Literal a, Literal b) {
+        while ( a != b ) {
+            if ( depth[a.index()] < depth[b.index()] ) b = parent[b.index()];
+            else a = parent[a.index()];
+        }
+        return a;
+    };
+    vector<std::pair<Literal,Literal> > resolvents;
+    bool conflict = false;
+    for ( const auto & l : candidates ) {
+        if ( budget == 0 || conflict ) break;
+        if ( get_asigned_value(l) != LIT_UNASIGNED || implied[l.index()] )
+            continue;
+
+        assume(l);
+        bool failed_literal = ! propagation().is_undef();
+        size_t begin = static_cast<size_t>(trail_limit[0]);
+        budget -= std::min<uint64_t>(budget, trail.size() - begin);
+        resolvents.clear();
+        if ( ! failed_literal ) {
+            depth[l.index()] = 0;
+            // after the limit the tree is not built, a later resolvent could
+            // depend on a missing one
+            bool full = false;
+            for ( size_t i = begin + 1; i < trail.size(); ++i ) {
+                Literal r = trail[i];
+                implied[r.index()] = true;
+                if ( full ) continue;
+                const Antecedent &a = antecedents[r.var()];
+                Literal d = l;
+                if ( a.is_binary() ) d = !a.get_literal();
+                else {
+                    // d implies all the false literals of the clause, so
+                    // (!d r) is the hyper binary resolvent
+                    const Clause &c = ca[a.ref];
+                    bool first = true;
+                    for ( unsigned int k = 1; k < c.size(); ++k ) {
+                        if ( decision_levels[c[k].var()] == 0 ) continue;
+                        d = first ? !c[k] : dominator(d, !c[k]);
+                        first = false;
+                    }
+                    if ( binaries + resolvents.size() >= binary_limit ) {
+                        full = true;
+                        continue;
+                    }
+                    resolvents.emplace_back(!d, r);
+                }
+                parent[r.index()] = d;
+                depth[r.index()] = depth[d.index()] + 1;
+            }
+        }
+        cancel_until(0);
+
+        if ( failed_literal ) {
+            ++failed;
+            if ( proof != nullptr ) proof->add(vector<Literal>{ !l });
+            conflict = assign(!l, Antecedent()) ||
+                ! propagation().is_undef();
+            continue;
+        }
+        for ( const auto & b : resolvents ) {
+            if ( proof != nullptr )
+                proof->add(vector<Literal>{ b.first, b.second });
+            attach_binary(b.first, b.second);
+            ++number_of_binary_clauses;
+        }
+        binaries += resolvents.size();
+    }
+    saved_phase = phases;
+
+    if ( failed > 0 || binaries > 0 )
+        PRINT("probing: failed literals " << failed << ", binary clauses " <<
+                binaries << endl);
+    return conflict;
+}
+
+bool SATSolver::restore_eliminated() {
+    PRINT_VERBOSE("restore " << number_of_eliminated << " variables" << endl);
+    vector<vector<Literal> > removed;
+    extension.for_each_clause([&removed](const vector<Literal> &c) {
+            removed.push_back(c); });
+    extension.clear();
+
+    for ( unsigned int v = 0; v < number_of_variable; ++v ) {
+        if ( ! eliminated[v] ) continue;
+        eliminated[v] = false;
+        order.restore(v);
+    }
+    number_of_eliminated = 0;
+
+    for ( auto & c : removed )
+        if ( add_clause(c) ) return true;
+    return false;
+}
+
+void SATSolver::remove_from_vect( vector<Watcher> &v, CRef c ) {
     for ( auto &i : v ) {
-        if ( i.get_clause() == c ) {
+        if ( i.clause == c ) {
             i = v.back();
             v.pop_back();
             return;
@@ -582,30 +1468,55 @@ void SATSolver::remove_from_vect( vector<Watcher> &v, ClausePtr c ) {
     assert(false);
 }
 
-void SATSolver::remove_clause( ClausePtr c ) {
-    remove_from_vect( watch_list[c->at(0).index()], c );
-    remove_from_vect( watch_list[c->at(1).index()], c );
+void SATSolver::check_garbage() {
+    if ( ca.wasted() > ca.size() * param.garbage_fraction )
+        garbage_collect();
+}
+
+void SATSolver::garbage_collect() {
+    // build a new arena with only the live clauses, sized exactly
+    Clause_Allocator to;
+    to.reserve( ca.size() - ca.wasted() );
+    relocate_all(to);
+    PRINT_VERBOSE("garbage collection: " << ca.size() << " -> " <<
+            to.size() << " words" << endl);
+    ca = std::move(to);
+}
+
+void SATSolver::relocate_all(Clause_Allocator &to) {
+    // watchers
+    for ( auto & ws : watch_list )
+        for ( auto & w : ws )
+            ca.relocate(w.clause,to);
+
+    // antecedents, only for the assigned literals
+    for ( const auto & l : trail )
+        if ( antecedents[l.var()].is_clause() )
+            ca.relocate(antecedents[l.var()].ref,to);
 
-    Clause::deallocate( c );
+    // clause collections
+    for ( auto & c : learned ) ca.relocate(c,to);
+    for ( auto & c : clauses ) ca.relocate(c,to);
 }
 
-void SATSolver::literals_activity_decay() {
-    // if big value is reached, a normalization is required
+void SATSolver::variables_activity_decay() {
+    // if big value is reached, a normalization is required. All the
+    // activities are scaled by the same factor, so the heap is still valid
     if ( param.literal_activity_update > 1e100 ) {
-        for ( auto & l : literals_activity )
-            l/=1e100;
+        for ( auto & a : variables_activity )
+            a/=1e100;
         param.literal_activity_update/=1e100;
-        order.initialize_heap();
     }
     param.literal_activity_update*=param.literal_decay_factor;
 }
 
 void SATSolver::clause_activity_decay() {
 
-    // if big value is reached, a normalization is required
-    if ( param.clause_activity_update > 1e100 ) {
+    // if big value is reached, a normalization is required (the activity of
+    // a clause is stored as a float)
+    if ( param.clause_activity_update > 1e20 ) {
         for ( auto & c : learned )
-            c->renormalize_activity(param.clause_activity_update);
+            ca[c].renormalize_activity(param.clause_activity_update);
         param.clause_activity_update = 1.0;
     }
 
@@ -613,63 +1524,107 @@ void SATSolver::clause_activity_decay() {
 }
 
 void SATSolver::reduce_learned() {
-    size_t i = 0, j = 0; // use this indices to compact the vector
-    // Remove any clause below this activity
-    double  extra_lim = param.clause_activity_update / learned.size();
-
-    // sort learned clause by activity (in ascending order)
-    sort(learned.begin(), learned.end(),
-            [&](const ClausePtr& l, const ClausePtr& r)
-                { return l->get_activity() < r->get_activity(); });
-
-    // remove the first half
-    for ( ; i < learned.size()/2 ; ++i ) {
-        // keep a clause if is the antecedent of an asignment
-        if ( learned[i]->size() == 2 || 
-                antecedents[learned[i]->at(0).var()] == learned[i] )
-            learned[j++] = learned[i]; // keep the justification
-        else
-            remove_clause(learned[i]);
+    // the candidates for the removal are the local clauses not used since
+    // the last reduction and not locked as antecedent of an asignment
+    vector<size_t> candidates;
+    for ( size_t i = 0; i < learned.size(); ++i ) {
+        Clause &c = ca[learned[i]];
+        bool used = c.is_used();
+        c.set_used(false);
+        if ( c.get_tier() == TIER_CORE ) continue;
+        if ( c.get_tier() == TIER_MID ) {
+            // a mid clause get another chance as a local clause
+            if ( ! used ) {
+                c.set_tier(TIER_LOCAL);
+                ++local_learned;
+            }
+            continue;
+        }
+        if ( used || antecedents[c[0].var()] == Antecedent(learned[i]) )
+            continue;
+        candidates.push_back(i);
     }
 
-    // move the second half in the first half (this effectively delete the
-    // low activity clauses)
-    for (; i < learned.size(); ++i) {
-        // keep a clause if is the antecedent of an asignment
-        if ( learned[i]->size() == 2 || 
-                antecedents[learned[i]->at(0).var()] == learned[i] ||
-                learned[i]->get_activity() >= extra_lim )
-            learned[j++] = learned[i]; // keep the justification
-        else
-            remove_clause(learned[i]);
+    // the less active half of the candidates is removed, a partial
+    // selection is enough
+    size_t to_remove = std::min(candidates.size(), local_learned / 2);
+    auto activity = [&](size_t l, size_t r) {
+        return ca[learned[l]].get_activity() < ca[learned[r]].get_activity();
+    };
+    std::nth_element(candidates.begin(), candidates.begin() + to_remove,
+            candidates.end(), activity);
+    // the removed clauses are only marked, their watchers are removed with
+    // a single pass over the watch lists
+    for ( size_t k = 0; k < to_remove; ++k ) {
+        if ( proof != nullptr ) proof->remove(ca[learned[candidates[k]]]);
+        ca.free(learned[candidates[k]]);
+        learned[candidates[k]] = CREF_UNDEF;
     }
+    local_learned -= to_remove;
+    if ( to_remove > 0 ) sweep_watch_lists();
+    ++stats.reductions;
+    stats.reduced_clauses += to_remove;
 
-    // keep only the most active clause
+    // compact the vector
+    size_t j = 0;
+    for ( const auto & c : learned )
+        if ( c != CREF_UNDEF ) learned[j++] = c;
     learned.resize( j );
+    PRINT_VERBOSE("reduce learned: removed " << to_remove << ", local " <<
+            local_learned << endl);
+}
+
+unsigned int SATSolver::new_variable() {
+    set_number_of_variable(number_of_variable + 1);
+    return number_of_variable - 1;
 }
 
 void SATSolver::set_number_of_variable(unsigned int n) {
-    // right now, it is possible to set the number of variable only one time
-    if ( number_of_variable != 0 )
-        // TODO: write a proper interface
-        throw std::runtime_error("multiple resize not supported yet");
+    // the variables can be added, but never removed
+    if ( n < number_of_variable )
+        throw std::runtime_error("the number of variables can't decrease");
+    if ( n == number_of_variable ) return;
 
+    // the new variables must also be in the order heap
+    unsigned int first = number_of_variable;
     number_of_variable = n;
 
     watch_list.resize( 2 * number_of_variable );
-    literals_activity.resize( 2 * number_of_variable, 0.0);
+    binary_watch_list.resize( 2 * number_of_variable );
+    variables_activity.resize( number_of_variable, 0.0);
+    saved_phase.resize( number_of_variable, false );
+    occurrence_balance.resize( number_of_variable, 0 );
+    target_phase.resize( number_of_variable, false );
+    best_phase.resize( number_of_variable, false );
 
     values.resize(n,LIT_UNASIGNED);
     decision_levels.resize(n,-1);
-    antecedents.resize(n,nullptr);
+    antecedents.resize(n,Antecedent());
     analisys_seen.resize(n);
-    order.set_size( 2 * number_of_variable );
+    eliminated.resize(n, false);
+    order.set_size( number_of_variable );
+    for ( unsigned int v = first; v < n; ++v ) order.insert(v);
+}
+
+void SATSolver::reserve_clauses(unsigned int n) {
+    // it is only an estimate, assume 3 literals per clause
+    clauses.reserve(n);
+    ca.reserve( n * Clause::words(3,false) );
+
+    // every long clause is watched two times
+    if ( number_of_variable == 0 ) return;
+    size_t watches = n / number_of_variable;
+    for ( auto & w : watch_list ) w.reserve(watches);
 }
 
 void SATSolver::set_log( int l) {
     log_level = l;
 }
 
+void SATSolver::set_restart_policy(restart_mode m) {
+    param.restart_policy = m;
+}
+
 void SATSolver::set_restarting_multiplier(unsigned int b) {
     param.restart_interval_multiplier = b;
 }
@@ -682,10 +1637,18 @@ void SATSolver::set_preprocessing(bool p) {
     param.enable_preprocessing = p;
 }
 
+void SATSolver::set_preprocessing_threads(unsigned int t) {
+    param.preprocessing_threads = t;
+}
+
 void SATSolver::set_restart(bool r) {
     param.enable_restart = r;
 }
 
+void SATSolver::set_vivification(bool v) {
+    param.enable_vivification = v;
+}
+
 void SATSolver::set_random_choice( bool r ) {
     param.enable_random_choice = r;
 }
@@ -712,6 +1675,192 @@ void SATSolver::set_learning_increase( double value ) {
     param.percentual_learn_increase = value;
 }
 
+void SATSolver::set_polarity( polarity_mode p ) {
+    param.polarity = p;
+}
+
+void SATSolver::set_target_phase( bool t ) {
+    param.enable_target_phase = t;
+}
+
+void SATSolver::set_rephase( bool r ) {
+    param.enable_rephase = r;
+}
+
+void SATSolver::set_random_seed( uint32_t seed ) {
+    // spread the seed over the state of the generator (the default state is
+    // used for seed 0). seed_2 must never be 0
+    seed_1 = 123456789 ^ (seed * 2654435761u);
+    seed_2 = 362436000 ^ (seed * 2246822519u);
+    if ( seed_2 == 0 ) seed_2 = 362436000;
+    seed_3 = 521288629 ^ (seed * 3266489917u);
+    seed_4 = 7654321   ^ (seed * 668265263u);
+}
+
+void SATSolver::set_interrupt( const std::atomic<bool> *flag ) {
+    interrupt_flag = flag;
+}
+
+bool SATSolver::interrupted() const {
+    return search_interrupted;
+}
+
+bool SATSolver::proved_unsat() const {
+    return root_conflict;
+}
+
+const vector<Literal>& SATSolver::get_failed_assumptions() const {
+    return failed_assumptions;
+}
+
+void SATSolver::set_terminate( std::function<bool()> callback ) {
+    terminate_callback = callback;
+}
+
+void SATSolver::set_learn( unsigned int max_size,
+        std::function<void(const vector<Literal>&)> callback ) {
+    learn_callback_size = max_size;
+    learn_callback = callback;
+}
+
+bool SATSolver::propagate_literal(Literal l) {
+    // the consequences of the units must be at level 0, not in the new level
+    if ( current_level() == 0 && propagation_starting_pos < trail.size() &&
+            ! propagation().is_undef() ) {
+        set_root_conflict();
+        return true;
+    }
+    if ( root_conflict ) return true;
+
+    trail_limit.push_back(static_cast<int>(trail.size()));
+    if ( assign(l, Antecedent()) ) return true;
+    return ! propagation().is_undef();
+}
+
+void SATSolver::backtrack(unsigned int level) {
+    if ( static_cast<unsigned int>(current_level()) > level )
+        cancel_until(static_cast<int>(level));
+}
+
+unsigned int SATSolver::get_decision_level() const {
+    return static_cast<unsigned int>(current_level());
+}
+
+size_t SATSolver::get_assigned_variables() const {
+    return number_of_assigned_variable();
+}
+
+literal_value SATSolver::get_value(Literal l) const {
+    return get_asigned_value(l);
+}
+
+double SATSolver::get_activity(var v) const {
+    return variables_activity[v];
+}
+
+unsigned int SATSolver::get_number_of_variable() const {
+    return number_of_variable;
+}
+
+void SATSolver::set_clause_exchange( Clause_Exchange *e, unsigned int id ) {
+    exchange = e;
+    exchange_id = id;
+    exchange_cursor = 0;
+}
+
+void SATSolver::set_sharing_limits( unsigned int max_size,
+        unsigned int max_lbd ) {
+    param.share_max_size = max_size;
+    param.share_max_lbd = max_lbd;
+}
+
+void SATSolver::set_sharing_rate( double clauses_per_conflict ) {
+    param.share_export_rate = clauses_per_conflict;
+}
+
+uint64_t SATSolver::get_exported_clauses() const {
+    return exported_clauses;
+}
+
+uint64_t SATSolver::get_imported_clauses() const {
+    return imported_clauses;
+}
+
+uint64_t SATSolver::get_conflicts() const {
+    return stats.conflicts;
+}
+
+uint64_t SATSolver::get_propagations() const {
+    return stats.propagations;
+}
+
+SolverStats SATSolver::get_stats() const {
+    SolverStats s = stats;
+    s.variables = number_of_variable;
+    s.clauses = clauses.size();
+    s.binary_clauses = number_of_binary_clauses;
+    s.learned = learned.size();
+
+    s.clause_bytes = ca.bytes() +
+        (clauses.capacity() + learned.capacity()) * sizeof(CRef);
+    s.watch_bytes = watch_list.capacity() * sizeof(watch_list[0]);
+    for ( const auto & w : watch_list )
+        s.watch_bytes += w.capacity() * sizeof(Watcher);
+    s.binary_watch_bytes =
+        binary_watch_list.capacity() * sizeof(binary_watch_list[0]);
+    for ( const auto & b : binary_watch_list )
+        s.binary_watch_bytes += b.capacity() * sizeof(Literal);
+
+    // the bit vectors are counted as bytes, and the decision heap as a
+    // variable and a position for each variable
+    s.variable_bytes =
+        values.capacity() * sizeof(literal_value) +
+        decision_levels.capacity() * sizeof(int) +
+        antecedents.capacity() * sizeof(Antecedent) +
+        trail.capacity() * sizeof(Literal) +
+        analisys_seen.capacity() * sizeof(uint8_t) +
+        variables_activity.capacity() * sizeof(double) +
+        occurrence_balance.capacity() * sizeof(int) +
+        (eliminated.capacity() + saved_phase.capacity() +
+         target_phase.capacity() + best_phase.capacity()) / 8 +
+        number_of_variable * (sizeof(var) + sizeof(int));
+    s.extension_bytes = extension.bytes();
+    return s;
+}
+
+void SATSolver::set_progress( double interval,
+        std::function<void(const SolverStats&)> callback ) {
+    progress_interval = std::chrono::duration<double>(interval);
+    progress_callback = callback;
+    last_progress = std::chrono::steady_clock::now();
+}
+
+void SATSolver::report_progress() {
+    if ( ! progress_callback ) return;
+    auto now = std::chrono::steady_clock::now();
+    if ( now - last_progress < progress_interval ) return;
+    last_progress = now;
+    progress_callback(get_stats());
+}
+
+void SATSolver::set_proof( Proof_Writer *p ) {
+    proof = p;
+}
+
+void SATSolver::write_proof_units() {
+    if ( proof == nullptr ) return;
+    size_t level_0 = trail_limit.empty() ? trail.size() :
+        static_cast<size_t>(trail_limit[0]);
+    for ( ; proof_units < level_0; ++proof_units )
+        proof->add(&trail[proof_units], &trail[proof_units] + 1);
+}
+
+void SATSolver::set_root_conflict() {
+    if ( proof != nullptr && ! root_conflict )
+        proof->add(vector<Literal>());
+    root_conflict = true;
+}
+
 inline unsigned int SATSolver::random() {
     return random_kiss();
 }
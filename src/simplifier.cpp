@@ -0,0 +1,448 @@
+#include <algorithm>
+#include <thread>
+#include "simplifier.hpp"
+
+namespace Satyricon {
+
+void Extension_Stack::push(Literal witness, const std::vector<Literal> &clause)
+{
+    assert( std::find(clause.begin(), clause.end(), witness) != clause.end() );
+    literals.push_back(witness);
+    for ( const auto & l : clause )
+        if ( l != witness ) literals.push_back(l);
+    sizes.push_back(clause.size());
+}
+
+void Extension_Stack::extend(std::vector<literal_value> &values) const {
+    for ( auto & v : values )
+        if ( v == LIT_UNASIGNED ) v = LIT_FALSE;
+
+    auto is_true = [&values](Literal l) {
+        return values[l.var()] == (l.sign() ? LIT_FALSE : LIT_TRUE);
+    };
+
+    size_t end = literals.size();
+    for ( size_t k = sizes.size(); k-- > 0; ) {
+        size_t begin = end - sizes[k];
+        bool satisfied = false;
+        for ( size_t i = begin; i < end && ! satisfied; ++i )
+            satisfied = is_true(literals[i]);
+        if ( ! satisfied ) {
+            Literal w = literals[begin];
+            values[w.var()] = w.sign() ? LIT_FALSE : LIT_TRUE;
+        }
+        end = begin;
+    }
+}
+
+Clause_Simplifier::Clause_Simplifier(unsigned int number_of_variable) :
+    clauses(), removed(), signatures(), number_of_clauses(0),
+    number_of_subsumed(0), number_of_strengthened(0),
+    occurrences(2 * number_of_variable),
+    frozen(number_of_variable, false), eliminated(number_of_variable, false),
+    number_of_eliminated(0), number_of_substituted(0), touched(),
+    is_touched(number_of_variable, false),
+    marks(2 * number_of_variable, 0), stamp(0), resolvents(), steps(0),
+    proof(nullptr)
+{}
+
+void Clause_Simplifier::add_clause(const std::vector<Literal> &c) {
+    size_t index = clauses.size();
+    clauses.push_back(c);
+    removed.push_back(false);
+    signatures.push_back(signature(c));
+    ++number_of_clauses;
+    for ( const auto & l : c ) occurrences[l.index()].push_back(index);
+}
+
+void Clause_Simplifier::freeze(var v) {
+    frozen[v] = true;
+}
+
+void Clause_Simplifier::remove_clause(size_t c) {
+    // the occurrence lists are cleaned lazily
+    removed[c] = true;
+    --number_of_clauses;
+}
+
+std::vector<size_t> &Clause_Simplifier::occurrences_of(Literal l) {
+    auto &occ = occurrences[l.index()];
+    occ.erase(std::remove_if(occ.begin(), occ.end(),
+                [this](size_t c) { return removed[c]; }), occ.end());
+    return occ;
+}
+
+void Clause_Simplifier::touch(var v) {
+    if ( is_touched[v] || eliminated[v] || frozen[v] ) return;
+    is_touched[v] = true;
+    touched.push_back(v);
+}
+
+bool Clause_Simplifier::substitute(Extension_Stack &extension) {
+    // binary implication graph: the clause (a b) give !a -> b and !b -> a
+    size_t n = occurrences.size();
+    std::vector<std::vector<Literal> > implications(n);
+    for ( size_t i = 0; i < clauses.size(); ++i ) {
+        if ( removed[i] || clauses[i].size() != 2 ) continue;
+        Literal a = clauses[i][0], b = clauses[i][1];
+        implications[(!a).index()].push_back(b);
+        implications[(!b).index()].push_back(a);
+    }
+
+    // the representative of a component is its literal with the smallest
+    // variable, a frozen one if possible. The component of !l is made of
+    // the negations, so its representative is the negation too
+    auto better = [this](Literal a, Literal b) {
+        if ( frozen[a.var()] != frozen[b.var()] ) return bool(frozen[a.var()]);
+        return a.var() < b.var();
+    };
+
+    // tarjan's algorithm, without recursion
+    struct Frame {
+        size_t l;    // literal index
+        size_t next; // next implication to visit
+    };
+    std::vector<uint32_t> order(n, 0), lowlink(n, 0);
+    std::vector<bool> on_stack(n, false);
+    std::vector<Literal> component_stack, component;
+    std::vector<Frame> frames;
+    std::vector<Literal> representative(n, UNDEF_LIT);
+    uint32_t counter = 0;
+    auto visit = [&](size_t l) {
+        order[l] = lowlink[l] = ++counter;
+        component_stack.push_back(Literal::from_index(static_cast<int>(l)));
+        on_stack[l] = true;
+        frames.push_back({l, 0});
+    };
+
+    for ( size_t root = 0; root < n; ++root ) {
+        if ( order[root] != 0 || implications[root].empty() ) continue;
+        visit(root);
+        while ( ! frames.empty() ) {
+            size_t l = frames.back().l;
+            if ( frames.back().next < implications[l].size() ) {
+                size_t m = implications[l][frames.back().next++].index();
+                if ( order[m] == 0 ) visit(m);
+                else if ( on_stack[m] )
+                    lowlink[l] = std::min(lowlink[l], order[m]);
+                continue;
+            }
+
+            frames.pop_back();
+            if ( ! frames.empty() ) {
+                size_t parent = frames.back().l;
+                lowlink[parent] = std::min(lowlink[parent], lowlink[l]);
+            }
+            if ( lowlink[l] != order[l] ) continue;
+
+            // l is the root of a component
+            component.clear();
+            Literal best = Literal::from_index(static_cast<int>(l));
+            Literal m;
+            do {
+                m = component_stack.back();
+                component_stack.pop_back();
+                on_stack[m.index()] = false;
+                component.push_back(m);
+                if ( better(m, best) ) best = m;
+            } while ( m.index() != l );
+            if ( component.size() == 1 ) continue;
+            for ( const auto & c : component )
+                representative[c.index()] = best;
+            // l and !l in the same component: l implies !l, so !l is a
+            // unit and then the empty clause follows
+            for ( const auto & c : component )
+                if ( representative[(!c).index()] == best ) {
+                    if ( proof != nullptr )
+                        proof->add(std::vector<Literal>{ !c });
+                    return false;
+                }
+        }
+    }
+
+    // the substituted variables, a frozen variable is never substituted
+    auto replace = [&](Literal l) {
+        Literal r = representative[Literal(l.var(),false).index()];
+        if ( r == UNDEF_LIT || frozen[l.var()] ) return l;
+        return l.sign() ? !r : r;
+    };
+    for ( var v = 0; v < static_cast<var>(frozen.size()); ++v ) {
+        Literal l(v,false);
+        Literal r = replace(l);
+        if ( r == l ) continue;
+        // the model of v is the value of the representative
+        extension.push(l, { l, !r });
+        extension.push(!l, { !l, r });
+        eliminated[v] = true;
+        ++number_of_substituted;
+    }
+    if ( number_of_substituted == 0 ) return true;
+
+    // replace the clauses with a substituted literal. The new clause can
+    // contain the same literal twice, or be a tautology. In the proof, the
+    // old clauses are removed after all the new ones, the new clauses are
+    // derived from the binary clauses of the components
+    std::vector<Literal> replaced;
+    std::vector<size_t> old_clauses;
+    size_t size = clauses.size();
+    for ( size_t i = 0; i < size; ++i ) {
+        if ( removed[i] ) continue;
+        bool changed = false;
+        for ( const auto & l : clauses[i] )
+            changed = changed || eliminated[l.var()];
+        if ( ! changed ) continue;
+
+        if ( ++stamp == 0 ) {
+            std::fill(marks.begin(), marks.end(), 0);
+            stamp = 1;
+        }
+        replaced.clear();
+        bool tautology = false;
+        for ( const auto & l : clauses[i] ) {
+            Literal r = replace(l);
+            if ( marks[(!r).index()] == stamp ) tautology = true;
+            if ( marks[r.index()] == stamp ) continue;
+            marks[r.index()] = stamp;
+            replaced.push_back(r);
+        }
+        remove_clause(i);
+        old_clauses.push_back(i);
+        if ( tautology ) continue;
+        if ( proof != nullptr ) proof->add(replaced);
+        add_clause(replaced);
+    }
+    if ( proof != nullptr )
+        for ( size_t i : old_clauses ) proof->remove(clauses[i]);
+    return true;
+}
+
+uint64_t Clause_Simplifier::signature(const std::vector<Literal> &c) {
+    uint64_t s = 0;
+    for ( const auto & l : c ) s |= uint64_t(1) << (l.var() & 63);
+    return s;
+}
+
+bool Clause_Simplifier::subsumes(size_t c, size_t d, Literal &flipped) const {
+    const auto &first = clauses[c];
+    const auto &second = clauses[d];
+    if ( first.size() > second.size() ||
+            (signatures[c] & ~signatures[d]) != 0 )
+        return false;
+
+    // the literals are sorted by variable, a merge is enough
+    flipped = UNDEF_LIT;
+    size_t j = 0;
+    for ( const auto & l : first ) {
+        while ( j < second.size() && second[j].var() < l.var() ) ++j;
+        if ( j == second.size() || second[j].var() != l.var() ) return false;
+        if ( second[j] != l ) {
+            if ( flipped != UNDEF_LIT ) return false;
+            flipped = second[j];
+        }
+        ++j;
+    }
+    return true;
+}
+
+void Clause_Simplifier::find_candidates(const std::vector<size_t> &sources,
+        size_t begin, size_t end,
+        std::vector<Subsumption_Candidate> &out) const {
+    for ( size_t k = begin; k < end; ++k ) {
+        size_t c = sources[k];
+        if ( removed[c] ) continue;
+
+        // every clause subsumed or strengthened by c contain l or !l, so
+        // the variable with less occurrences is used
+        Literal best = clauses[c][0];
+        size_t best_size = SIZE_MAX;
+        for ( const auto & l : clauses[c] ) {
+            size_t size = occurrences[l.index()].size() +
+                occurrences[(!l).index()].size();
+            if ( size < best_size ) {
+                best = l;
+                best_size = size;
+            }
+        }
+        if ( best_size > 2 * occurrence_limit ) continue;
+
+        for ( Literal l : { best, !best } ) {
+            for ( size_t d : occurrences[l.index()] ) {
+                if ( d == c || removed[d] ) continue;
+                Literal flipped;
+                // two equal clauses are candidates in both directions, only
+                // the first one found is removed
+                if ( subsumes(c, d, flipped) ) out.push_back({c, d});
+            }
+        }
+    }
+}
+
+bool Clause_Simplifier::subsume(unsigned int threads) {
+    std::vector<size_t> sources;
+    for ( size_t i = 0; i < clauses.size(); ++i ) {
+        if ( removed[i] ) continue;
+        std::sort(clauses[i].begin(), clauses[i].end(),
+                [](Literal a, Literal b) { return a.index() < b.index(); });
+        sources.push_back(i);
+    }
+
+    // the candidates are found on the original clauses, and checked again
+    // before changing the formula. A strengthened clause is a source for
+    // the next round
+    std::vector<std::vector<Subsumption_Candidate> > candidates;
+    std::vector<bool> is_source(clauses.size(), false);
+    while ( ! sources.empty() ) {
+        size_t parts = sources.size() >= parallel_threshold ? threads : 1;
+        candidates.assign(std::max<size_t>(parts, 1), {});
+        if ( candidates.size() == 1 )
+            find_candidates(sources, 0, sources.size(), candidates[0]);
+        else {
+            std::vector<std::thread> workers;
+            for ( size_t i = 0; i < candidates.size(); ++i )
+                workers.emplace_back([&, i]() {
+                        find_candidates(sources,
+                            i * sources.size() / candidates.size(),
+                            (i+1) * sources.size() / candidates.size(),
+                            candidates[i]);
+                    });
+            for ( auto & w : workers ) w.join();
+        }
+
+        sources.clear();
+        for ( const auto & part : candidates ) {
+            for ( const auto & s : part ) {
+                Literal flipped;
+                if ( removed[s.c] || removed[s.d] ||
+                        ! subsumes(s.c, s.d, flipped) )
+                    continue;
+                if ( flipped == UNDEF_LIT ) {
+                    if ( proof != nullptr ) proof->remove(clauses[s.d]);
+                    remove_clause(s.d);
+                    ++number_of_subsumed;
+                    continue;
+                }
+
+                // strengthen d, the resolvent of c and d
+                auto &d = clauses[s.d];
+                d.erase(std::find(d.begin(), d.end(), flipped));
+                if ( proof != nullptr ) {
+                    proof->add(d);
+                    std::vector<Literal> old = d;
+                    old.push_back(flipped);
+                    proof->remove(old);
+                }
+                auto &occ = occurrences[flipped.index()];
+                occ.erase(std::find(occ.begin(), occ.end(), s.d));
+                signatures[s.d] = signature(d);
+                ++number_of_strengthened;
+                if ( d.empty() ) return false; // unsatisfiable
+                if ( ! is_source[s.d] ) {
+                    is_source[s.d] = true;
+                    sources.push_back(s.d);
+                }
+            }
+        }
+        for ( size_t c : sources ) is_source[c] = false;
+    }
+    return true;
+}
+
+bool Clause_Simplifier::resolve(size_t c, size_t d, var v,
+        std::vector<Literal> &resolvent) {
+    if ( ++stamp == 0 ) {
+        std::fill(marks.begin(), marks.end(), 0);
+        stamp = 1;
+    }
+    steps += clauses[c].size() + clauses[d].size();
+
+    resolvent.clear();
+    for ( const auto & l : clauses[c] ) {
+        if ( l.var() == static_cast<unsigned int>(v) ) continue;
+        marks[l.index()] = stamp;
+        resolvent.push_back(l);
+    }
+    for ( const auto & l : clauses[d] ) {
+        if ( l.var() == static_cast<unsigned int>(v) ) continue;
+        if ( marks[(!l).index()] == stamp ) return false; // tautology
+        if ( marks[l.index()] != stamp ) resolvent.push_back(l);
+    }
+    return true;
+}
+
+bool Clause_Simplifier::try_eliminate(var v, Extension_Stack &extension) {
+    // copies, the occurrence lists change when the resolvents are added
+    std::vector<size_t> positive = occurrences_of(Literal(v,false));
+    std::vector<size_t> negative = occurrences_of(Literal(v,true));
+    if ( positive.empty() && negative.empty() ) return true; // unused
+    if ( positive.size() > occurrence_limit ||
+            negative.size() > occurrence_limit )
+        return true;
+
+    // the elimination must not increase the number of clauses
+    size_t limit = positive.size() + negative.size();
+    size_t count = 0;
+    std::vector<Literal> resolvent;
+    for ( size_t p : positive ) {
+        for ( size_t n : negative ) {
+            // resolve charge the visited literals, the budget can end in
+            // the middle of a variable (it is not eliminated)
+            if ( steps >= step_limit ) return true;
+            if ( ! resolve(p, n, v, resolvent) ) continue;
+            if ( ++count > limit || resolvent.size() > resolvent_limit )
+                return true;
+            if ( count > resolvents.size() ) resolvents.emplace_back();
+            resolvents[count-1].swap(resolvent);
+        }
+    }
+
+    // the old clauses are replaced by the resolvents
+    if ( proof != nullptr ) {
+        for ( size_t i = 0; i < count; ++i ) proof->add(resolvents[i]);
+        for ( size_t c : positive ) proof->remove(clauses[c]);
+        for ( size_t c : negative ) proof->remove(clauses[c]);
+    }
+    eliminated[v] = true;
+    ++number_of_eliminated;
+    for ( size_t sign = 0; sign < 2; ++sign ) {
+        Literal witness(v, sign == 1);
+        for ( size_t c : sign == 0 ? positive : negative ) {
+            extension.push(witness, clauses[c]);
+            for ( const auto & l : clauses[c] ) touch(l.var());
+            remove_clause(c);
+        }
+    }
+    for ( size_t i = 0; i < count; ++i ) {
+        if ( resolvents[i].empty() ) return false; // unsatisfiable
+        add_clause(resolvents[i]);
+    }
+    return true;
+}
+
+bool Clause_Simplifier::eliminate(Extension_Stack &extension) {
+    for ( var v = 0; v < static_cast<var>(frozen.size()); ++v ) touch(v);
+
+    // every round try the variables in the changed clauses, the cheapest
+    // ones first
+    std::vector<var> queue;
+    while ( ! touched.empty() && steps < step_limit ) {
+        queue.swap(touched);
+        touched.clear();
+        for ( var v : queue ) is_touched[v] = false;
+
+        auto cost = [this](var v) {
+            return occurrences[Literal(v,false).index()].size() *
+                occurrences[Literal(v,true).index()].size();
+        };
+        std::sort(queue.begin(), queue.end(),
+                [&cost](var a, var b) { return cost(a) < cost(b); });
+
+        for ( var v : queue ) {
+            if ( steps >= step_limit ) break;
+            if ( eliminated[v] ) continue;
+            if ( ! try_eliminate(v, extension) ) return false;
+        }
+    }
+    return true;
+}
+
+} // end namespace Satyricon
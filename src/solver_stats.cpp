@@ -0,0 +1,64 @@
+#include <sstream>
+#include "solver_stats.hpp"
+
+namespace Satyricon {
+
+const std::vector<Stats_Field>& stats_fields() {
+    static const std::vector<Stats_Field> fields = {
+        {"decisions", "decisions of the search", true,
+            &SolverStats::decisions},
+        {"propagations", "propagated literals", true,
+            &SolverStats::propagations},
+        {"conflicts", "conflicts of the search", true,
+            &SolverStats::conflicts},
+        {"restarts", "restarts of the search", true,
+            &SolverStats::restarts},
+        {"reductions", "reductions of the learned clauses", true,
+            &SolverStats::reductions},
+        {"reduced_clauses", "learned clauses removed by the reductions",
+            true, &SolverStats::reduced_clauses},
+        {"uip_literals",
+            "literals of the learned clauses before the minimization", true,
+            &SolverStats::uip_literals},
+        {"learned_literals",
+            "literals of the learned clauses after the minimization", true,
+            &SolverStats::learned_literals},
+        {"watch_visits", "watchers in the lists of the propagated literals",
+            true, &SolverStats::watch_visits},
+        {"binary_visits",
+            "binary implications of the propagated literals", true,
+            &SolverStats::binary_visits},
+        {"variables", "variables of the formula", false,
+            &SolverStats::variables},
+        {"clauses", "long clauses of the formula", false,
+            &SolverStats::clauses},
+        {"binary_clauses", "binary clauses of the formula", false,
+            &SolverStats::binary_clauses},
+        {"learned", "long learned clauses", false, &SolverStats::learned},
+        {"clause_bytes", "memory of the clause arena and references", false,
+            &SolverStats::clause_bytes},
+        {"watch_bytes", "memory of the watch lists", false,
+            &SolverStats::watch_bytes},
+        {"binary_watch_bytes", "memory of the binary implication lists",
+            false, &SolverStats::binary_watch_bytes},
+        {"variable_bytes", "memory of the assignment and of the heuristics",
+            false, &SolverStats::variable_bytes},
+        {"extension_bytes", "memory of the clauses of eliminated variables",
+            false, &SolverStats::extension_bytes},
+    };
+    return fields;
+}
+
+std::string to_json(const SolverStats &s) {
+    std::ostringstream out;
+    out << "{";
+    bool first = true;
+    for ( const auto &f : stats_fields() ) {
+        out << (first ? "" : ",") << "\"" << f.name << "\":" << s.*f.value;
+        first = false;
+    }
+    out << "}";
+    return out.str();
+}
+
+} // end namespace Satyricon
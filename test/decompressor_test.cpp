@@ -0,0 +1,119 @@
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "decompressor.hpp"
+
+#ifdef SATYRICON_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef SATYRICON_HAVE_BZIP2
+#include <bzlib.h>
+#endif
+
+using std::cout; using std::endl;
+using std::string; using std::vector;
+using Satyricon::compression_format;
+
+/**
+ * Regression check of the multi-member inputs: every member is returned by
+ * a different read(), so a member always ends with an empty input buffer,
+ * like on a pipe where the writer sends one file at a time.
+ */
+
+namespace {
+
+const char *members[] = {
+    "p cnf 3 2\n1 -2 0\n",
+    "2 3 0\n",
+    "c the last member\n-1 -3 0\n"
+};
+
+#ifdef SATYRICON_HAVE_ZLIB
+string compress_gzip(const string &text) {
+    z_stream zs;
+    std::memset(&zs, 0, sizeof(zs));
+    // 15 + 16: maximum window, gzip header
+    if ( deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8,
+                Z_DEFAULT_STRATEGY) != Z_OK )
+        throw std::runtime_error("unable to initialize zlib");
+    string out(deflateBound(&zs, text.size()) + 32, '\0');
+    zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(text.data()));
+    zs.avail_in = static_cast<uInt>(text.size());
+    zs.next_out = reinterpret_cast<Bytef*>(&out[0]);
+    zs.avail_out = static_cast<uInt>(out.size());
+    int ret = deflate(&zs, Z_FINISH);
+    out.resize(zs.total_out);
+    deflateEnd(&zs);
+    if ( ret != Z_STREAM_END ) throw std::runtime_error("gzip failed");
+    return out;
+}
+#endif
+
+#ifdef SATYRICON_HAVE_BZIP2
+string compress_bzip2(const string &text) {
+    string out(text.size() + text.size() / 100 + 600, '\0');
+    unsigned int size = static_cast<unsigned int>(out.size());
+    if ( BZ2_bzBuffToBuffCompress(&out[0], &size,
+                const_cast<char*>(text.data()),
+                static_cast<unsigned int>(text.size()), 9, 0, 0) != BZ_OK )
+        throw std::runtime_error("bzip2 failed");
+    out.resize(size);
+    return out;
+}
+#endif
+
+// decompress the compressed members, one for each read
+bool check(compression_format format, string (*compress)(const string&)) {
+    vector<string> input;
+    string expected;
+    for ( const char *m : members ) {
+        input.push_back(compress(m));
+        expected += m;
+    }
+
+    size_t next = 0;
+    Satyricon::Read_Function read = [&](char *buffer, size_t size) {
+        if ( next == input.size() ) return size_t(0);
+        const string &m = input[next++];
+        if ( m.size() > size ) throw std::runtime_error("member too big");
+        std::memcpy(buffer, m.data(), m.size());
+        return m.size();
+    };
+    string result;
+    Satyricon::Write_Function write = [&](const char *data, size_t size) {
+        result.append(data, size);
+        return true;
+    };
+
+    Satyricon::decompress(format, read, write);
+    return result == expected;
+}
+
+} // end anonymous namespace
+
+int main() {
+    int failures = 0;
+    try {
+#ifdef SATYRICON_HAVE_ZLIB
+        if ( ! check(Satyricon::COMPRESSION_GZIP, compress_gzip) ) {
+            cout << "FAIL: gzip members split between reads" << endl;
+            ++failures;
+        }
+#endif
+#ifdef SATYRICON_HAVE_BZIP2
+        if ( ! check(Satyricon::COMPRESSION_BZIP2, compress_bzip2) ) {
+            cout << "FAIL: bzip2 streams split between reads" << endl;
+            ++failures;
+        }
+#endif
+    }
+    catch (const std::exception &e) {
+        cout << "FAIL: " << e.what() << endl;
+        return 1;
+    }
+    if ( failures == 0 ) cout << "OK" << endl;
+    return failures == 0 ? 0 : 1;
+}